@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file board_host.cpp
+ *
+ * Board support for running EBLmon code on a development host.
+ *
+ * The cycle counter runs in nanoseconds, keys are pressed by the host
+ * tool and the display is one of the simulated devices. Serial data is
+ * read from a file, FIFO or pty and paced to the line rate by the system
+ * tick.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "board_host.h"
+#include "u8g_dev_sim.h"
+
+Board_Host board_host;
+Board *gBoard = &board_host;
+
+static uint64_t
+now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+Board_Host::Board_Host() :
+    Board(&Sim::u8g_dev_sim_page)
+{
+    const char *s;
+
+    if (getenv("EBLMON_VIRTUAL") != nullptr) {
+        OS::PosixTickMode = OS::ptmVirtual;
+    }
+
+    if ((s = getenv("EBLMON_FRAMES")) != nullptr) {
+        Sim::set_frame_dir(s);
+    }
+
+    if ((s = getenv("EBLMON_SHM")) != nullptr) {
+        if (!Sim::set_shm(s)) {
+            fprintf(stderr, "%s: could not create shared memory\n", s);
+        }
+    }
+
+    memset(_settings, 0xff, sizeof(_settings));
+
+    if ((s = getenv("EBLMON_SETTINGS")) != nullptr) {
+        settings_open(s);
+    }
+}
+
+/****************************************************************************
+ * Serial port
+ */
+
+void
+Board_Host::com_init(unsigned speed)
+{
+    const char *path = getenv("EBLMON_SERIAL");
+    const char *tx_path;
+    struct stat st;
+
+    _com_speed = speed;
+    _start_ns = now_ns();
+
+    if ((tx_path = getenv("EBLMON_SERIAL_TX")) != nullptr) {
+        _com_tx_fd = open(tx_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (_com_tx_fd < 0) {
+            perror(tx_path);
+            exit(1);
+        }
+    }
+
+    if (path == nullptr) {
+        return;
+    }
+
+    _com_fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+
+    if (_com_fd < 0) {
+        perror(path);
+        exit(1);
+    }
+
+    // a pipe or pty with nobody on the other end yet reads as EOF
+    _com_stream = (fstat(_com_fd, &st) == 0) && !S_ISREG(st.st_mode);
+}
+
+// the "transmission" completes at once; without a file the data is discarded
+void
+Board_Host::com_tx_start()
+{
+    const uint8_t *data;
+    unsigned len;
+
+    while ((data = com_tx_peek(len)) != nullptr) {
+        if (_com_tx_fd >= 0) {
+            if (write(_com_tx_fd, data, len) < 0) {
+                perror("EBLMON_SERIAL_TX");
+                close(_com_tx_fd);
+                _com_tx_fd = -1;
+            }
+        }
+
+        com_tx_done(len);
+    }
+}
+
+bool
+Board_Host::com_fill()
+{
+    auto ret = read(_com_fd, _com_buf, sizeof(_com_buf));
+
+    if (ret > 0) {
+        _com_buf_head = 0;
+        _com_buf_tail = ret;
+        _com_stream = false;
+        return true;
+    }
+
+    if ((ret < 0) && (errno == EAGAIN || errno == EINTR)) {
+        return false;
+    }
+
+    // EOF, or the pty was hung up
+    if (!_com_stream && (_drain == 0)) {
+        _drain = _drain_ticks;
+    }
+
+    return false;
+}
+
+void
+Board_Host::tick()
+{
+    if (_com_fd < 0) {
+        return;
+    }
+
+    if (_drain > 0) {
+        if (--_drain == 0) {
+            report_and_exit();
+        }
+        return;
+    }
+
+    _com_credit += _com_speed;
+
+    while (_com_credit >= 10000) {
+        if ((_com_buf_head == _com_buf_tail) && !com_fill()) {
+            // line idle, don't bank the time
+            _com_credit = 0;
+            break;
+        }
+
+        _com_credit -= 10000;
+        _com_bytes++;
+        com_interrupts++;
+        com_rx(_com_buf[_com_buf_head++]);
+    }
+}
+
+void
+Board_Host::report_and_exit()
+{
+    auto virtual_ms = OS::get_tick_count();
+    auto real_ms = (now_ns() - _start_ns) / 1000000;
+
+    fprintf(stderr, "host: %u bytes, %u good / %u bad packets, %u frames\n",
+            _com_bytes, EBL::good_packets, EBL::bad_packets, Sim::frames);
+    fprintf(stderr, "host: %lu ms simulated in %lu ms, %.1fx real time\n",
+            (unsigned long)virtual_ms, (unsigned long)real_ms,
+            real_ms ? (double)virtual_ms / real_ms : 0.0);
+    exit(0);
+}
+
+namespace OS
+{
+void
+posix_tick_user_hook()
+{
+    board_host.tick();
+}
+} // namespace OS
+
+/****************************************************************************
+ * Storage
+ *
+ * The file behaves as NOR flash: erased bytes are 0xff and programming
+ * can only clear bits. Operations complete at once.
+ */
+
+uint32_t
+Board_Host::storage_init()
+{
+    const char *path = getenv("EBLMON_STORAGE");
+    const char *size_str = getenv("EBLMON_STORAGE_SIZE");
+    uint32_t size = size_str ? strtoul(size_str, nullptr, 0) : (4 * 1024 * 1024);
+    struct stat st;
+
+    if (path == nullptr) {
+        return 0;
+    }
+
+    _storage_fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if ((_storage_fd < 0) || (fstat(_storage_fd, &st) < 0)) {
+        perror(path);
+        exit(1);
+    }
+
+    // a new file starts out erased
+    if (st.st_size == 0) {
+        uint8_t erased[storage_sector_size];
+
+        memset(erased, 0xff, sizeof(erased));
+
+        for (uint32_t address = 0; address < size; address += sizeof(erased)) {
+            if (pwrite(_storage_fd, erased, sizeof(erased), address) != sizeof(erased)) {
+                perror(path);
+                exit(1);
+            }
+        }
+
+        return size;
+    }
+
+    return st.st_size;
+}
+
+void
+Board_Host::storage_erase(uint32_t address)
+{
+    uint8_t erased[storage_sector_size];
+
+    memset(erased, 0xff, sizeof(erased));
+
+    if (pwrite(_storage_fd, erased, sizeof(erased), address & ~(storage_sector_size - 1)) < 0) {
+        perror("EBLMON_STORAGE");
+    }
+}
+
+void
+Board_Host::storage_program(uint32_t address, const void *data, unsigned len)
+{
+    uint8_t buf[storage_page_size];
+    auto src = static_cast<const uint8_t *>(data);
+
+    if (len > sizeof(buf)) {
+        len = sizeof(buf);
+    }
+
+    storage_read(address, buf, len);
+
+    for (unsigned i = 0; i < len; i++) {
+        buf[i] &= src[i];
+    }
+
+    if (pwrite(_storage_fd, buf, len, address) < 0) {
+        perror("EBLMON_STORAGE");
+    }
+}
+
+void
+Board_Host::storage_read(uint32_t address, void *data, unsigned len)
+{
+    auto ret = pread(_storage_fd, data, len, address);
+
+    if (ret < (ssize_t)len) {
+        memset(static_cast<uint8_t *>(data) + (ret > 0 ? ret : 0), 0xff, len - (ret > 0 ? ret : 0));
+    }
+}
+
+/****************************************************************************
+ * Settings
+ *
+ * Pages are kept in RAM, and written through to the file if there is one.
+ * Programming a word ANDs it in, as flash would.
+ */
+
+void
+Board_Host::settings_open(const char *path)
+{
+    _settings_fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (_settings_fd < 0) {
+        perror(path);
+        exit(1);
+    }
+
+    // a new or short file reads as erased
+    if (pread(_settings_fd, _settings, sizeof(_settings), 0) < (ssize_t)sizeof(_settings)) {
+        settings_sync(0, sizeof(_settings));
+    }
+}
+
+void
+Board_Host::settings_sync(unsigned offset, unsigned len)
+{
+    if ((_settings_fd >= 0) &&
+        (pwrite(_settings_fd, reinterpret_cast<uint8_t *>(_settings) + offset, len, offset) < 0)) {
+        perror("EBLMON_SETTINGS");
+    }
+}
+
+const uint16_t *
+Board_Host::settings_page(unsigned page)
+{
+    return &_settings[page * settings_page_size / 2];
+}
+
+void
+Board_Host::settings_erase(unsigned page)
+{
+    memset(&_settings[page * settings_page_size / 2], 0xff, settings_page_size);
+    settings_sync(page * settings_page_size, settings_page_size);
+}
+
+void
+Board_Host::settings_program(unsigned page, unsigned offset, uint16_t value)
+{
+    auto index = (page * settings_page_size + offset) / 2;
+
+    _settings[index] &= value;
+    settings_sync(index * 2, 2);
+}
+
+/****************************************************************************
+ * Timing
+ */
+
+uint32_t
+Board_Host::cycle_count()
+{
+    return now_ns();
+}
+
+unsigned
+Board_Host::cycles_per_us()
+{
+    return 1000;
+}
+
+/****************************************************************************
+ * m2 event source
+ */
+
+uint8_t
+m2_board_es(m2_p ep __unused, uint8_t msg)
+{
+    switch (msg) {
+    case M2_ES_MSG_GET_KEY:
+        return board_host.key;
+    }
+
+    return 0;
+}
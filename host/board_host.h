@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file board_host.h
+ *
+ * Board support for running EBLmon code on a development host.
+ */
+
+#pragma once
+
+#include "board.h"
+
+/**
+ * Host board.
+ *
+ * When the firmware processes run on the host, the board is configured
+ * from the environment:
+ *
+ * EBLMON_SERIAL        File, FIFO or pty to read serial data from. Data
+ *                      is delivered at the configured line rate.
+ * EBLMON_SERIAL_TX     File to write transmitted serial data (telemetry)
+ *                      to. Console text goes to stdout as usual.
+ * EBLMON_STORAGE       File standing in for the recorder's flash; made
+ *                      EBLMON_STORAGE_SIZE bytes (default 4MiB) if new.
+ * EBLMON_SETTINGS      File holding the settings flash; settings are kept
+ *                      in RAM only if unset.
+ * EBLMON_VIRTUAL       If set, run in virtual time; see the POSIX port.
+ * EBLMON_FRAMES        Directory to write each display frame to.
+ * EBLMON_SHM           Shared memory object to publish frames through.
+ *
+ * When the serial data runs out the board waits a second for the last
+ * packets to be processed, reports and exits.
+ */
+class Board_Host : public Board
+{
+public:
+    Board_Host();
+
+    virtual void        com_init(unsigned speed) override;
+    virtual uint32_t    cycle_count() override;
+    virtual unsigned    cycles_per_us() override;
+    virtual uint32_t    storage_init() override;
+    virtual void        storage_erase(uint32_t address) override;
+    virtual void        storage_program(uint32_t address, const void *data, unsigned len) override;
+    virtual void        storage_read(uint32_t address, void *data, unsigned len) override;
+    virtual const uint16_t *settings_page(unsigned page) override;
+    virtual void        settings_erase(unsigned page) override;
+    virtual void        settings_program(unsigned page, unsigned offset, uint16_t value) override;
+
+    /**
+     * Feed serial data for one tick.
+     *
+     * Called in interrupt context by the system tick.
+     */
+    void                tick();
+
+    /**
+     * Select the simulated display.
+     *
+     * Must be called before UI::init().
+     *
+     * @param dev           The u8g device to draw to.
+     */
+    void                set_display(u8g_dev_t *dev) { _u8g_dev = dev; }
+
+    /** m2 key currently held down, M2_KEY_NONE when released */
+    uint8_t             key = M2_KEY_NONE;
+
+protected:
+    virtual void        com_tx_start() override;
+
+private:
+    static const unsigned _drain_ticks = 1000;
+
+    int                 _com_fd = -1;
+    int                 _com_tx_fd = -1;
+    int                 _storage_fd = -1;
+    int                 _settings_fd = -1;
+    uint16_t            _settings[2 * settings_page_size / 2];
+    bool                _com_stream = false;    ///< EOF only counts once data has been seen
+    unsigned            _com_speed = 0;
+    unsigned            _com_credit = 0;        ///< line rate credit, 10000 per byte
+    uint8_t             _com_buf[4096];
+    unsigned            _com_buf_head = 0;
+    unsigned            _com_buf_tail = 0;
+    unsigned            _com_bytes = 0;
+    unsigned            _drain = 0;             ///< ticks left after EOF, 0 while data flows
+    uint64_t            _start_ns = 0;
+
+    bool                com_fill();
+    void                settings_open(const char *path);
+    void                settings_sync(unsigned offset, unsigned len);
+    void                report_and_exit();
+};
+
+extern Board_Host board_host;
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file capture2ebl.cpp
+ *
+ * Extract fault captures from an EBLmon console capture.
+ *
+ * Each complete capture is written to capture-<n>.ebl as a stream of
+ * EBL packets rebuilt from the captured frames, which can be fed back
+ * through the host build (EBLMON_SERIAL) to replay the fault. A line
+ * describing each capture is printed.
+ *
+ *   capture2ebl console.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "capture.h"
+#include "cobs.h"
+#include "crc.h"
+#include "log.h"
+
+namespace
+{
+
+using namespace Capture;
+
+const unsigned message_size = 14 + frame_data_size + 2;
+
+struct Message {
+    uint8_t                     capture;
+    uint8_t                     index;
+    uint8_t                     count;
+    uint8_t                     trigger;
+    uint8_t                     triggers;
+    uint32_t                    timestamp;
+    uint32_t                    sequence;
+    uint8_t                     data[frame_data_size];
+};
+
+std::vector<Message> pending;
+unsigned bad;
+
+void
+usage()
+{
+    fprintf(stderr, "usage: capture2ebl [<console capture>]\n");
+    exit(1);
+}
+
+uint32_t
+get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void
+write_capture()
+{
+    auto &first = pending.front();
+    char name[32];
+
+    snprintf(name, sizeof(name), "capture-%u.ebl", first.capture);
+
+    FILE *fp = fopen(name, "wb");
+
+    if (fp == nullptr) {
+        perror(name);
+        exit(1);
+    }
+
+    for (auto &m : pending) {
+        uint8_t packet[277];
+        unsigned sum = 0;
+
+        packet[0] = 0x55;
+        packet[1] = 0xaa;
+        memcpy(&packet[2], m.data, 256);
+        packet[258] = 0;                        // status, not captured
+        memcpy(&packet[259], &m.data[256], 16);
+
+        for (unsigned i = 0; i < 275; i++)
+            sum += packet[i];
+
+        packet[275] = sum >> 8;
+        packet[276] = sum;
+        fwrite(packet, sizeof(packet), 1, fp);
+    }
+
+    fclose(fp);
+
+    auto &trigger = pending[first.trigger];
+
+    printf("%s: %s%s%s%s%u frames, trigger at packet %u, %u.%03u s\n", name,
+           (first.triggers & TRIG_SES) ? "SES " : "",
+           (first.triggers & TRIG_DTC) ? "DTC " : "",
+           (first.triggers & TRIG_OIL_LOW) ? "oil-low " : "",
+           (first.triggers & TRIG_CTS_HIGH) ? "CTS-high " : "",
+           first.count, trigger.sequence, trigger.timestamp / 1000, trigger.timestamp % 1000);
+}
+
+void
+message(const uint8_t *p, unsigned len)
+{
+    if ((len != message_size) ||
+        (CRC::crc16(p, len - 2) != (p[len - 2] | (p[len - 1] << 8)))) {
+        bad++;
+        return;
+    }
+
+    Message m;
+
+    m.capture = p[1];
+    m.index = p[2];
+    m.count = p[3];
+    m.trigger = p[4];
+    m.triggers = p[5];
+    m.timestamp = get32(&p[6]);
+    m.sequence = get32(&p[10]);
+    memcpy(m.data, &p[14], frame_data_size);
+
+    // a capture is only kept if all of its frames arrive in order
+    if ((m.index != pending.size()) ||
+        (!pending.empty() && (m.capture != pending.front().capture))) {
+        pending.clear();
+
+        if (m.index != 0)
+            return;
+    }
+
+    pending.push_back(m);
+
+    if ((pending.size() == m.count) && (m.trigger < m.count)) {
+        write_capture();
+        pending.clear();
+    }
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    FILE *fp = stdin;
+
+    if (argc > 2)
+        usage();
+
+    if (argc == 2) {
+        fp = fopen(argv[1], "rb");
+
+        if (fp == nullptr) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    static COBS::Reader<512> reader;
+    int c;
+
+    while ((c = getc(fp)) != EOF) {
+        unsigned plen = reader.put(c);
+
+        if ((plen > 0) && (reader.data()[0] == Log::LOG_FRAME_CAPTURE))
+            message(reader.data(), plen);
+    }
+
+    bad += reader.bad();
+
+    if (bad > 0)
+        fprintf(stderr, "%u bad frames\n", bad);
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file deltabench.cpp
+ *
+ * Measure the Delta frame codec against an EBL capture.
+ *
+ * The capture is a raw stream of EBL packets, as read from the ECU or
+ * written by capture2ebl; packets with bad checksums are skipped. Every
+ * frame is coded and decoded and the round trip checked, then each
+ * direction is timed over the whole capture, repeated for at least a
+ * second.
+ *
+ *   deltabench [-k <keyframe interval>] capture.ebl ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "delta.h"
+
+namespace
+{
+
+const unsigned packet_size = 277;
+const unsigned status_offset = 258;             // status byte, not in a frame
+
+typedef std::chrono::steady_clock Clock;
+
+std::vector<uint8_t> frames;                    // block_size bytes each
+std::vector<uint8_t> coded;                     // max_encoded bytes each
+std::vector<uint16_t> coded_len;
+unsigned interval = DELTA_KEYFRAME;
+unsigned bad;
+
+void
+usage()
+{
+    fprintf(stderr, "usage: deltabench [-k <keyframe interval>] <EBL capture> ...\n");
+    exit(1);
+}
+
+void
+load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+
+    if (fp == nullptr) {
+        perror(path);
+        exit(1);
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.insert(data.end(), buf, buf + n);
+
+    fclose(fp);
+
+    // scan for headers, resynchronising after a bad packet
+    size_t pos = 0;
+
+    while ((pos + packet_size) <= data.size()) {
+        auto p = &data[pos];
+
+        if ((p[0] != 0x55) || (p[1] != 0xaa)) {
+            pos++;
+            continue;
+        }
+
+        unsigned sum = 0;
+
+        for (unsigned i = 0; i < (packet_size - 2); i++)
+            sum += p[i];
+
+        if ((sum & 0xffff) != unsigned((p[packet_size - 2] << 8) | p[packet_size - 1])) {
+            bad++;
+            pos++;
+            continue;
+        }
+
+        frames.insert(frames.end(), &p[2], &p[status_offset]);
+        frames.insert(frames.end(), &p[status_offset + 1], &p[packet_size - 2]);
+        pos += packet_size;
+    }
+}
+
+unsigned
+count()
+{
+    return frames.size() / Delta::block_size;
+}
+
+size_t
+encode_all()
+{
+    Delta::Encoder encoder(interval);
+    size_t total = 0;
+
+    for (unsigned i = 0; i < count(); i++) {
+        coded_len[i] = encoder.encode(&frames[i * Delta::block_size], &coded[i * Delta::max_encoded]);
+        total += coded_len[i];
+    }
+
+    return total;
+}
+
+bool
+decode_all(uint8_t *out)
+{
+    Delta::Decoder decoder;
+
+    for (unsigned i = 0; i < count(); i++) {
+        if (!decoder.decode(&coded[i * Delta::max_encoded], coded_len[i], out))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Run a pass repeatedly for at least a second.
+ *
+ * @return                      Frames per second.
+ */
+template<typename F>
+double
+bench(F pass)
+{
+    unsigned passes = 0;
+    auto start = Clock::now();
+    std::chrono::duration<double> elapsed;
+
+    do {
+        pass();
+        passes++;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < 1.0);
+
+    return (double)passes * count() / elapsed.count();
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    int arg = 1;
+
+    if ((argc > 2) && !strcmp(argv[1], "-k")) {
+        interval = strtoul(argv[2], nullptr, 0);
+        arg += 2;
+    }
+
+    if ((arg >= argc) || (interval < 1))
+        usage();
+
+    for (; arg < argc; arg++)
+        load(argv[arg]);
+
+    if (bad > 0)
+        fprintf(stderr, "%u bad packets skipped\n", bad);
+
+    if (count() == 0) {
+        fprintf(stderr, "no frames\n");
+        return 1;
+    }
+
+    coded.resize(count() * Delta::max_encoded + Delta::encode_buffer_size);
+    coded_len.resize(count());
+
+    // check the round trip
+    auto total = encode_all();
+    unsigned keys = 0;
+    Delta::Decoder decoder;
+    uint8_t out[Delta::block_size];
+
+    for (unsigned i = 0; i < count(); i++) {
+        if (coded[i * Delta::max_encoded] == Delta::DELTA_KEY)
+            keys++;
+
+        if (!decoder.decode(&coded[i * Delta::max_encoded], coded_len[i], out) ||
+            memcmp(out, &frames[i * Delta::block_size], Delta::block_size)) {
+            fprintf(stderr, "frame %u does not decode\n", i);
+            return 1;
+        }
+    }
+
+    printf("%u frames, %u key frames, %zu bytes coded to %zu, ratio %.2f:1, %.1f bytes/frame\n",
+           count(), keys, frames.size(), total, (double)frames.size() / total, (double)total / count());
+
+    double encode_rate = bench([] { encode_all(); });
+    double decode_rate = bench([&out] { decode_all(out); });
+
+    printf("encode %.0f frames/s, %.1f MB/s\n", encode_rate, encode_rate * Delta::block_size / 1e6);
+    printf("decode %.0f frames/s, %.1f MB/s\n", decode_rate, decode_rate * Delta::block_size / 1e6);
+    return 0;
+}
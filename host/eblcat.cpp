@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file eblcat.cpp
+ *
+ * Decode a raw EBL capture.
+ *
+ * The capture is mapped and scanned for packet headers; packets are
+ * checked and converted with the firmware's own code (ebl_packet.h and
+ * ebl_channels.cpp), using the default settings. The scan resynchronises
+ * as EBL::decode() does, so it finds the packets the device would have
+ * shown: a header byte not followed by the second header byte is
+ * skipped along with that byte, and a packet with a bad checksum is
+ * skipped whole. One row is written per good packet:
+ *
+ *   packet                     index of the good packet
+ *   offset                     of the packet in the capture
+ *   engine_speed ... dtc       the channels, in the units of EBLmon.h
+ *
+ * as CSV, or with -b as columns:
+ *
+ *   magic                      "EBLC"
+ *   columns                    32 bits
+ *   rows                       32 bits
+ *   names                      32 bytes per column, NUL padded
+ *   data                       each column in turn, 32 bits per row
+ *                              except offset, which is 64 bits
+ *
+ * with numbers little-endian. Counts go to stderr.
+ *
+ *   eblcat [-b] capture.bin > capture.csv
+ *   eblcat --bench capture.bin
+ *
+ * --bench decodes the capture over and over for a second without
+ * writing anything, and reports the rate.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+#include "EBLmon.h"
+#include "ebl_packet.h"
+#include "settings.h"
+
+// ebl_channels.cpp takes its calibration from here
+uint16_t
+Settings::get(Key key)
+{
+    return (key < NUM_SETTINGS) ? defaults[key] : 0;
+}
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct Column {
+    const char                  *name;
+    unsigned                    (*value)(const EBL::Frame &frame);
+};
+
+const Column columns[] = {
+    { "engine_speed",           EBL::engine_speed },
+    { "road_speed",             EBL::ground_speed },
+    { "water_temperature",      EBL::water_temperature },
+    { "oil_pressure",           EBL::oil_pressure },
+    { "voltage",                EBL::voltage },
+    { "afr",                    EBL::afr },
+    { "ses",                    [](const EBL::Frame &f) -> unsigned { return EBL::ses_set(f); } },
+    { "running",                [](const EBL::Frame &f) -> unsigned { return EBL::engine_running(f); } },
+    { "dtc",                    [](const EBL::Frame &f) -> unsigned {
+                                    return f.mem[0x12] | (f.mem[0x13] << 8) | (f.mem[0x14] << 16);
+                                } },
+};
+const unsigned num_columns = sizeof(columns) / sizeof(columns[0]);
+const unsigned fixed_columns = 2;               // packet, offset
+const unsigned name_size = 32;
+
+unsigned packets;
+unsigned bad;
+
+void
+usage()
+{
+    fprintf(stderr, "usage: eblcat [-b | --bench] <EBL capture>\n");
+    exit(1);
+}
+
+/**
+ * Find and decode every packet.
+ *
+ * @param row                   Called with the packet offset and frame
+ *                              for each good packet.
+ */
+template<typename F>
+void
+scan(const uint8_t *data, size_t size, F row)
+{
+    EBL::Frame frame;
+
+    packets = 0;
+    bad = 0;
+
+    if (size < EBL::packet_size)
+        return;
+
+    const uint8_t *p = data;
+    const uint8_t *last = data + size - EBL::packet_size;
+
+    while (p <= last) {
+        p = static_cast<const uint8_t *>(memchr(p, EBL::packet_h1, last - p + 1));
+
+        if (p == nullptr)
+            break;
+
+        // as EBL::decode(), a second byte that is not h2 is not
+        // rechecked as h1
+        if (p[1] != EBL::packet_h2) {
+            p += 2;
+            continue;
+        }
+
+        // as EBL::decode(), the search resumes after a bad packet
+        if (!EBL::packet_valid(p)) {
+            bad++;
+            p += EBL::packet_size;
+            continue;
+        }
+
+        EBL::packet_unpack(p, frame);
+        frame.sequence = packets++;
+        row(p - data, frame);
+        p += EBL::packet_size;
+    }
+}
+
+class CSVWriter
+{
+public:
+    CSVWriter()
+    {
+        fputs("packet,offset", stdout);
+
+        for (auto &c : columns)
+            printf(",%s", c.name);
+
+        putchar('\n');
+    }
+
+    ~CSVWriter()
+    {
+        flush();
+    }
+
+    void                        row(size_t offset, const EBL::Frame &frame)
+    {
+        if ((_len + 16 * (fixed_columns + num_columns)) > sizeof(_buf))
+            flush();
+
+        put(frame.sequence);
+        _buf[_len++] = ',';
+        put(offset);
+
+        for (auto &c : columns) {
+            _buf[_len++] = ',';
+            put(c.value(frame));
+        }
+
+        _buf[_len++] = '\n';
+    }
+
+private:
+    char                        _buf[65536];
+    size_t                      _len = 0;
+
+    void                        put(size_t value)
+    {
+        char digits[20];
+        unsigned n = 0;
+
+        do {
+            digits[n++] = '0' + (value % 10);
+            value /= 10;
+        } while (value > 0);
+
+        while (n > 0)
+            _buf[_len++] = digits[--n];
+    }
+
+    void                        flush()
+    {
+        fwrite(_buf, 1, _len, stdout);
+        _len = 0;
+    }
+};
+
+class ColumnStore
+{
+public:
+    void                        clear()
+    {
+        _packets.clear();
+        _offsets.clear();
+
+        for (auto &v : _data)
+            v.clear();
+    }
+
+    void                        row(size_t offset, const EBL::Frame &frame)
+    {
+        _packets.push_back(frame.sequence);
+        _offsets.push_back(offset);
+
+        for (unsigned i = 0; i < num_columns; i++)
+            _data[i].push_back(columns[i].value(frame));
+    }
+
+    void                        write()
+    {
+        const uint32_t header[2] = { fixed_columns + num_columns, (uint32_t)_packets.size() };
+        const char *fixed_names[fixed_columns] = { "packet", "offset" };
+        char name[name_size];
+
+        fwrite("EBLC", 4, 1, stdout);
+        fwrite(header, sizeof(header), 1, stdout);
+
+        for (unsigned i = 0; i < (fixed_columns + num_columns); i++) {
+            memset(name, 0, sizeof(name));
+            strncpy(name, (i < fixed_columns) ? fixed_names[i] : columns[i - fixed_columns].name, sizeof(name) - 1);
+            fwrite(name, sizeof(name), 1, stdout);
+        }
+
+        fwrite(_packets.data(), sizeof(_packets[0]), _packets.size(), stdout);
+        fwrite(_offsets.data(), sizeof(_offsets[0]), _offsets.size(), stdout);
+
+        for (auto &v : _data)
+            fwrite(v.data(), sizeof(v[0]), v.size(), stdout);
+    }
+
+private:
+    std::vector<uint32_t>       _packets;
+    std::vector<uint64_t>       _offsets;       // captures can pass 4 GiB
+    std::vector<uint32_t>       _data[num_columns];
+};
+
+void
+bench(const uint8_t *data, size_t size)
+{
+    ColumnStore store;
+    unsigned passes = 0;
+    auto start = Clock::now();
+    std::chrono::duration<double> elapsed;
+
+    do {
+        store.clear();
+        scan(data, size, [&store](size_t offset, const EBL::Frame &frame) { store.row(offset, frame); });
+        passes++;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < 1.0);
+
+    double seconds = elapsed.count() / passes;
+
+    printf("%zu bytes, %u packets, %u bad, %u passes\n", size, packets, bad, passes);
+    printf("%.1f MB/s, %.0f packets/s\n", size / seconds / 1e6, packets / seconds);
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    bool binary = false;
+    bool benchmark = false;
+    int arg = 1;
+
+    if (argc > 1) {
+        if (!strcmp(argv[1], "-b")) {
+            binary = true;
+            arg++;
+
+        } else if (!strcmp(argv[1], "--bench")) {
+            benchmark = true;
+            arg++;
+        }
+    }
+
+    if (arg != (argc - 1))
+        usage();
+
+    int fd = open(argv[arg], O_RDONLY);
+    struct stat st;
+
+    if ((fd < 0) || (fstat(fd, &st) < 0)) {
+        perror(argv[arg]);
+        return 1;
+    }
+
+    size_t size = st.st_size;
+    const uint8_t *data = nullptr;
+
+    if (size > 0) {
+        auto map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+
+        if (map == MAP_FAILED) {
+            perror(argv[arg]);
+            return 1;
+        }
+
+        madvise(map, size, MADV_SEQUENTIAL);
+        data = static_cast<const uint8_t *>(map);
+    }
+
+    close(fd);
+
+    if (benchmark) {
+        bench(data, size);
+        return 0;
+    }
+
+    if (binary) {
+        ColumnStore store;
+
+        scan(data, size, [&store](size_t offset, const EBL::Frame &frame) { store.row(offset, frame); });
+        store.write();
+
+    } else {
+        CSVWriter csv;
+
+        scan(data, size, [&csv](size_t offset, const EBL::Frame &frame) { csv.row(offset, frame); });
+    }
+
+    fprintf(stderr, "%u packets, %u bad\n", packets, bad);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file logexpand.cpp
+ *
+ * Expand the tokenized EBLmon console into text.
+ *
+ * The format strings are read from the .logstr section of the firmware
+ * ELF; the console capture is read from a file or stdin, so a serial
+ * port can be expanded live:
+ *
+ *   logexpand EBLmon.elf < /dev/ttyUSB0
+ *   logexpand EBLmon.elf console.bin | trace2json > trace.json
+ */
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cobs.h"
+#include "log.h"
+
+namespace
+{
+
+std::map<uint16_t, std::string> formats;
+
+void
+usage()
+{
+    fprintf(stderr, "usage: logexpand <firmware ELF> [<console capture>]\n");
+    exit(1);
+}
+
+/**
+ * Load the format strings from the .logstr section of an ELF file.
+ */
+template <typename Ehdr, typename Shdr>
+bool
+load_formats(const std::vector<uint8_t> &elf)
+{
+    if (elf.size() < sizeof(Ehdr))
+        return false;
+
+    auto eh = (const Ehdr *)&elf[0];
+
+    if ((eh->e_shoff == 0) ||
+        (eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Shdr) > elf.size()) ||
+        (eh->e_shstrndx >= eh->e_shnum))
+        return false;
+
+    auto sh = (const Shdr *)&elf[eh->e_shoff];
+    auto &strtab = sh[eh->e_shstrndx];
+
+    for (unsigned i = 0; i < eh->e_shnum; i++) {
+        if ((strtab.sh_offset + sh[i].sh_name >= elf.size()) ||
+            strcmp((const char *)&elf[strtab.sh_offset + sh[i].sh_name], ".logstr"))
+            continue;
+
+        if (sh[i].sh_offset + sh[i].sh_size > elf.size())
+            return false;
+
+        auto base = (const char *)&elf[sh[i].sh_offset];
+
+        // strings are padded to their alignment; skip the padding
+        for (uint64_t offset = 0; offset < sh[i].sh_size;) {
+            if (base[offset] == '\0') {
+                offset++;
+                continue;
+            }
+
+            std::string fmt(base + offset, strnlen(base + offset, sh[i].sh_size - offset));
+            formats[(uint16_t)(sh[i].sh_addr + offset)] = fmt;
+            offset += fmt.size() + 1;
+        }
+
+        return true;
+    }
+
+    fprintf(stderr, "no .logstr section\n");
+    return false;
+}
+
+bool
+load_elf(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+
+    if (fp == nullptr) {
+        perror(path);
+        return false;
+    }
+
+    std::vector<uint8_t> elf;
+    uint8_t buf[4096];
+    size_t len;
+
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        elf.insert(elf.end(), buf, buf + len);
+
+    fclose(fp);
+
+    if ((elf.size() < EI_NIDENT) || memcmp(&elf[0], ELFMAG, SELFMAG)) {
+        fprintf(stderr, "%s: not an ELF file\n", path);
+        return false;
+    }
+
+    switch (elf[EI_CLASS]) {
+    case ELFCLASS32:
+        return load_formats<Elf32_Ehdr, Elf32_Shdr>(elf);
+
+    case ELFCLASS64:
+        return load_formats<Elf64_Ehdr, Elf64_Shdr>(elf);
+    }
+
+    fprintf(stderr, "%s: unknown ELF class\n", path);
+    return false;
+}
+
+/**
+ * Argument reader over a frame payload.
+ */
+struct Args {
+    const uint8_t               *p;
+    const uint8_t               *end;
+    bool                        ok;
+
+    uint32_t varint()
+    {
+        uint32_t value = 0;
+
+        for (unsigned shift = 0; shift < 35; shift += 7) {
+            if (p >= end)
+                break;
+
+            uint8_t c = *p++;
+            value |= (uint32_t)(c & 0x7f) << shift;
+
+            if (!(c & 0x80))
+                return value;
+        }
+
+        ok = false;
+        return 0;
+    }
+
+    const char *string()
+    {
+        auto s = (const char *)p;
+        auto len = strnlen(s, end - p);
+
+        if (len == (size_t)(end - p)) {
+            ok = false;
+            return "";
+        }
+
+        p += len + 1;
+        return s;
+    }
+};
+
+/**
+ * Format a line as printf would have on the device.
+ */
+std::string
+expand(const std::string &fmt, Args &args)
+{
+    std::string out;
+    char buf[256];
+
+    for (size_t i = 0; i < fmt.size(); i++) {
+        if (fmt[i] != '%') {
+            out += fmt[i];
+            continue;
+        }
+
+        // flags, width and precision are kept, length modifiers dropped;
+        // every integer argument was sent as 32 bits
+        std::string spec = "%";
+
+        while ((++i < fmt.size()) && strchr("-+ #0123456789.", fmt[i]))
+            spec += fmt[i];
+
+        while ((i < fmt.size()) && strchr("hlzjt", fmt[i]))
+            i++;
+
+        if (i >= fmt.size())
+            break;
+
+        char conv = fmt[i];
+        spec += conv;
+
+        switch (conv) {
+        case '%':
+            out += '%';
+            continue;
+
+        case 's':
+            snprintf(buf, sizeof(buf), spec.c_str(), args.string());
+            break;
+
+        case 'd':
+        case 'i':
+        case 'c':
+            snprintf(buf, sizeof(buf), spec.c_str(), (int32_t)args.varint());
+            break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            snprintf(buf, sizeof(buf), spec.c_str(), args.varint());
+            break;
+
+        default:
+            snprintf(buf, sizeof(buf), "<%%%c?>", conv);
+            break;
+        }
+
+        out += buf;
+    }
+
+    return out;
+}
+
+void
+frame(const uint8_t *payload, unsigned plen, unsigned &bad)
+{
+    switch (payload[0]) {
+    case Log::LOG_FRAME_TEXT: {
+        if (plen < 3) {
+            bad++;
+            return;
+        }
+
+        uint16_t id = payload[1] | (payload[2] << 8);
+        auto it = formats.find(id);
+
+        if (it == formats.end()) {
+            printf("<unknown message %04x>\n", id);
+            return;
+        }
+
+        Args args{&payload[3], &payload[plen], true};
+        auto line = expand(it->second, args);
+
+        printf("%s%s\n", line.c_str(), args.ok ? "" : " <truncated>");
+        break;
+    }
+
+    default:
+        // other frame types are not console text
+        break;
+    }
+
+    fflush(stdout);
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    FILE *fp = stdin;
+
+    if ((argc < 2) || (argc > 3))
+        usage();
+
+    if (!load_elf(argv[1]))
+        return 1;
+
+    if (argc == 3) {
+        fp = fopen(argv[2], "rb");
+
+        if (fp == nullptr) {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+
+    static COBS::Reader<256> reader;
+    unsigned bad = 0;
+    int c;
+
+    while ((c = getc(fp)) != EOF) {
+        unsigned plen = reader.put(c);
+
+        if (plen > 0)
+            frame(reader.data(), plen, bad);
+    }
+
+    bad += reader.bad();
+
+    if (bad > 0)
+        fprintf(stderr, "%u bad frames\n", bad);
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file recdump.cpp
+ *
+ * List the records in a flight recorder image.
+ *
+ * The image is a copy of the recorder's storage; on the host, the file
+ * named by EBLMON_STORAGE. Pages are put back in order and the records
+ * in them checked; torn or missing pages are skipped.
+ *
+ *   recdump [-s] flash.bin
+ *
+ * With -s only the totals are printed. Delta coded frames are decoded,
+ * and counted as undecodable if the key frame they depend on was lost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "crc.h"
+#include "delta.h"
+#include "recorder.h"
+
+namespace
+{
+
+using namespace Recorder;
+
+struct Page {
+    PageHeader                  header;
+    const uint8_t               *data;
+};
+
+bool summary_only;
+unsigned sessions, good, bad, lost_pages, undecodable;
+Delta::Decoder decoder;
+
+void
+usage()
+{
+    fprintf(stderr, "usage: recdump [-s] <recorder image>\n");
+    exit(1);
+}
+
+const char *
+type_name(unsigned type)
+{
+    switch (type) {
+    case REC_BOOT:  return "boot";
+
+    case REC_FRAME: return "frame";
+
+    case REC_FRAME_DELTA: return "delta";
+    }
+
+    return "?";
+}
+
+void
+record(const std::vector<uint8_t> &r)
+{
+    auto h = (const RecordHeader *)&r[0];
+    auto len = sizeof(*h) + h->length;
+    unsigned crc = r[len] | (r[len + 1] << 8);
+
+    if (CRC::crc16(&r[0], len) != crc) {
+        bad++;
+        decoder.reset();
+
+        if (!summary_only)
+            printf("%10s  bad CRC, %u bytes\n", "", h->length);
+
+        return;
+    }
+
+    good++;
+
+    if (h->type == REC_BOOT) {
+        sessions++;
+        decoder.reset();
+    }
+
+    const char *note = "";
+
+    if (h->type == REC_FRAME_DELTA) {
+        uint8_t frame[Delta::block_size];
+
+        if (!decoder.decode(&r[sizeof(*h)], h->length, frame)) {
+            undecodable++;
+            note = ", undecodable";
+        }
+    }
+
+    if (!summary_only)
+        printf("%6u.%03u  %-5s %u bytes%s\n", h->timestamp / 1000, h->timestamp % 1000,
+               type_name(h->type), h->length, note);
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    int arg = 1;
+
+    if ((argc > 1) && !strcmp(argv[1], "-s")) {
+        summary_only = true;
+        arg++;
+    }
+
+    if (arg != (argc - 1))
+        usage();
+
+    FILE *fp = fopen(argv[arg], "rb");
+
+    if (fp == nullptr) {
+        perror(argv[arg]);
+        return 1;
+    }
+
+    std::vector<uint8_t> image;
+    uint8_t buf[4096];
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        image.insert(image.end(), buf, buf + n);
+
+    fclose(fp);
+
+    std::vector<Page> pages;
+
+    for (size_t offset = 0; (offset + page_size) <= image.size(); offset += page_size) {
+        Page p;
+
+        memcpy(&p.header, &image[offset], sizeof(p.header));
+        p.data = &image[offset + sizeof(p.header)];
+
+        if ((p.header.magic == page_magic) && (p.header.used <= page_data_size))
+            pages.push_back(p);
+    }
+
+    std::sort(pages.begin(), pages.end(),
+              [](const Page &a, const Page &b) { return a.header.sequence < b.header.sequence; });
+
+    // records run from page to page; resynchronise at the first record
+    // of a page after a gap or a record that doesn't fit
+    std::vector<uint8_t> r;
+    bool synced = false;
+    uint32_t last_sequence = 0;
+
+    for (auto &p : pages) {
+        auto &h = p.header;
+        unsigned pos = 0;
+
+        if (synced && (h.sequence != last_sequence + 1)) {
+            lost_pages += h.sequence - last_sequence - 1;
+            synced = false;
+            decoder.reset();
+        }
+
+        last_sequence = h.sequence;
+
+        // a record left incomplete must finish where the first one starts
+        if (synced && (r.size() >= 2)) {
+            unsigned need = record_overhead + (r[0] | (r[1] << 8)) - r.size();
+
+            if ((h.first != no_record) ? (h.first != need) : (need < h.used)) {
+                bad++;
+                synced = false;
+                decoder.reset();
+            }
+        }
+
+        if (!synced) {
+            if (h.first == no_record)
+                continue;
+
+            r.clear();
+            pos = h.first;
+            synced = true;
+        }
+
+        for (; pos < h.used; pos++) {
+            r.push_back(p.data[pos]);
+
+            if (r.size() < sizeof(RecordHeader))
+                continue;
+
+            auto rh = (const RecordHeader *)&r[0];
+
+            if ((rh->check != (uint8_t)~rh->type) || (rh->length > (2 * page_data_size))) {
+                bad++;
+                synced = false;
+                decoder.reset();
+                break;
+            }
+
+            if (r.size() == (record_overhead + rh->length)) {
+                record(r);
+                r.clear();
+            }
+        }
+    }
+
+    printf("%zu pages, %u sessions, %u records, %u bad, %u pages lost, %u frames undecodable\n",
+           pages.size(), sessions, good, bad, lost_pages, undecodable);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file telemetry2csv.cpp
+ *
+ * Decode EBLmon binary telemetry into CSV.
+ *
+ * Reads a capture of the console from a file or stdin; console text
+ * frames are skipped. One row is written per telemetry message, with
+ * the values current after it. Values not yet known, or held over a
+ * lost message, are left empty until the next complete message.
+ *
+ *   telemetry2csv < /dev/ttyUSB0 > run.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cobs.h"
+#include "crc.h"
+#include "log.h"
+#include "telemetry.h"
+
+namespace
+{
+
+using namespace Telemetry;
+
+const char *const field_names[] = {
+    "engine_speed", "road_speed", "water_temperature", "oil_pressure",
+    "voltage", "afr", "status", "dtc_count"
+};
+static_assert(sizeof(field_names) / sizeof(field_names[0]) == NUM_FIELDS,
+              "field_names out of step with Field");
+
+uint32_t values[NUM_FIELDS];
+bool valid;
+bool have_count;
+uint8_t last_count;
+
+unsigned messages, bad, lost;
+
+void
+usage()
+{
+    fprintf(stderr, "usage: telemetry2csv [<console capture>]\n");
+    exit(1);
+}
+
+bool
+get_varint(const uint8_t *&p, const uint8_t *end, uint32_t &value)
+{
+    value = 0;
+
+    for (unsigned shift = 0; (shift < 35) && (p < end); shift += 7) {
+        uint8_t c = *p++;
+        value |= (uint32_t)(c & 0x7f) << shift;
+
+        if (!(c & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+void
+message(const uint8_t *payload, unsigned len)
+{
+    // type, count, sequence, mask, CRC
+    if (len < 6) {
+        bad++;
+        return;
+    }
+
+    unsigned crc = payload[len - 2] | (payload[len - 1] << 8);
+
+    if (CRC::crc16(payload, len - 2) != crc) {
+        bad++;
+        return;
+    }
+
+    auto p = &payload[2];
+    auto end = &payload[len - 2];
+    uint32_t sequence, mask;
+    uint32_t update[NUM_FIELDS];
+
+    if (!get_varint(p, end, sequence) || !get_varint(p, end, mask)) {
+        bad++;
+        return;
+    }
+
+    for (unsigned i = 0; i < NUM_FIELDS; i++) {
+        if ((mask & (1U << i)) && !get_varint(p, end, update[i])) {
+            bad++;
+            return;
+        }
+    }
+
+    uint8_t count = payload[1];
+
+    if (have_count && (count != (uint8_t)(last_count + 1))) {
+        lost += (uint8_t)(count - last_count - 1);
+        valid = false;
+    }
+
+    have_count = true;
+    last_count = count;
+    messages++;
+
+    if (mask == (1U << NUM_FIELDS) - 1)
+        valid = true;
+
+    for (unsigned i = 0; i < NUM_FIELDS; i++) {
+        if (mask & (1U << i))
+            values[i] = update[i];
+    }
+
+    printf("%u,%u", count, sequence);
+
+    for (unsigned i = 0; i < NUM_FIELDS; i++) {
+        if (valid)
+            printf(",%u", values[i]);
+        else
+            printf(",");
+    }
+
+    printf("\n");
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    FILE *fp = stdin;
+
+    if (argc > 2)
+        usage();
+
+    if (argc == 2) {
+        fp = fopen(argv[1], "rb");
+
+        if (fp == nullptr) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    printf("count,sequence");
+
+    for (auto name : field_names)
+        printf(",%s", name);
+
+    printf("\n");
+
+    static COBS::Reader<256> reader;
+    int c;
+
+    while ((c = getc(fp)) != EOF) {
+        unsigned plen = reader.put(c);
+
+        if ((plen > 0) && (reader.data()[0] == Log::LOG_FRAME_TELEMETRY))
+            message(reader.data(), plen);
+    }
+
+    bad += reader.bad();
+
+    fprintf(stderr, "%u messages, %u lost, %u bad frames\n", messages, lost, bad);
+    return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file trace2json.cpp
+ *
+ * Convert a trace dump from the EBLmon console into Chrome / Perfetto
+ * trace JSON.
+ *
+ * The last dump in the log is used; anything outside the dump markers
+ * is ignored, so a complete console capture can be fed straight in.
+ *
+ *   trace2json console.log > trace.json
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "trace.h"
+
+namespace
+{
+
+using Trace::Record;
+
+// thread IDs in the output
+enum : unsigned {
+    TID_IDLE = 1,               // process threads are TID_IDLE + priority
+    TID_FRAMES = 10,
+    TID_PACKETS = 11,
+    TID_ISR = 20,               // interrupt threads are TID_ISR + exception number
+};
+
+// priorities are in descending order, idle is 0
+const char *const process_names[] = { "Idle", "Timer", "GUI", "Deferred" };
+const unsigned num_processes = sizeof(process_names) / sizeof(process_names[0]);
+
+const char *
+exception_name(unsigned exception)
+{
+    static char buf[16];
+
+    switch (exception) {
+    case 0:  return "Tick";             // host builds
+
+    case 14: return "PendSV";
+
+    case 15: return "SysTick";
+
+    case 53: return "USART1";
+    }
+
+    snprintf(buf, sizeof(buf), "IRQ%u", exception - 16);
+    return buf;
+}
+
+void
+usage()
+{
+    fprintf(stderr, "usage: trace2json [<console log>]\n");
+    exit(1);
+}
+
+/**
+ * Find the last dump in the log.
+ */
+bool
+read_dump(FILE *fp, unsigned &cycles_per_us, std::vector<Record> &records)
+{
+    char line[128];
+    bool in_dump = false;
+    bool found = false;
+    std::vector<Record> current;
+    unsigned cpu = 0;
+
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        unsigned count;
+
+        if (sscanf(line, "trace begin %u %u", &cpu, &count) == 2) {
+            current.clear();
+            in_dump = true;
+            continue;
+        }
+
+        if (!in_dump)
+            continue;
+
+        if (!strcmp(line, "trace end")) {
+            records = current;
+            cycles_per_us = cpu;
+            in_dump = false;
+            found = true;
+            continue;
+        }
+
+        unsigned long timestamp;
+        unsigned event, id, data;
+
+        if ((strlen(line) != 16) ||
+            (sscanf(line, "%8lx%2x%2x%4x", &timestamp, &event, &id, &data) != 4)) {
+            fprintf(stderr, "ignoring '%s'\n", line);
+            continue;
+        }
+
+        Record r;
+        r.timestamp = timestamp;
+        r.event = (Trace::Event)event;
+        r.id = id;
+        r.data = data;
+        current.push_back(r);
+    }
+
+    return found && (cycles_per_us > 0);
+}
+
+bool first_event = true;
+
+void
+emit(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+void
+emit(const char *fmt, ...)
+{
+    va_list ap;
+
+    printf("%s\n    {", first_event ? "" : ",");
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("}");
+    first_event = false;
+}
+
+void
+thread_name(unsigned tid, const char *name)
+{
+    emit("\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}", tid, name);
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    FILE *fp = stdin;
+
+    if (argc > 2)
+        usage();
+
+    if (argc == 2) {
+        fp = fopen(argv[1], "r");
+
+        if (fp == nullptr) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    unsigned cycles_per_us = 0;
+    std::vector<Record> records;
+
+    if (!read_dump(fp, cycles_per_us, records)) {
+        fprintf(stderr, "no complete trace dump found\n");
+        return 1;
+    }
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    emit("\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"EBLmon\"}");
+
+    for (unsigned i = 0; i < num_processes; i++)
+        thread_name(TID_IDLE + i, process_names[i]);
+
+    thread_name(TID_FRAMES, "frames");
+    thread_name(TID_PACKETS, "packets");
+
+    uint64_t now = 0;
+    uint32_t last_timestamp = records.empty() ? 0 : records.front().timestamp;
+    bool have_switch = false;
+    double last_switch = 0;
+    bool isr_named[256] = {};
+    unsigned isr_depth[256] = {};
+
+    for (auto &r : records) {
+        // the cycle counter wraps every minute or so, the dump covers far less
+        now += (uint32_t)(r.timestamp - last_timestamp);
+        last_timestamp = r.timestamp;
+        double us = (double)now / cycles_per_us;
+
+        switch (r.event) {
+        case Trace::EV_SWITCH:
+            if (have_switch && (r.id < num_processes)) {
+                emit("\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                     process_names[r.id], TID_IDLE + r.id, last_switch, us - last_switch);
+            }
+
+            have_switch = true;
+            last_switch = us;
+            break;
+
+        case Trace::EV_ISR_ENTER:
+        case Trace::EV_ISR_EXIT: {
+            auto name = exception_name(r.id);
+
+            if (!isr_named[r.id]) {
+                thread_name(TID_ISR + r.id, name);
+                isr_named[r.id] = true;
+            }
+
+            if (r.event == Trace::EV_ISR_ENTER) {
+                isr_depth[r.id]++;
+
+            } else if (isr_depth[r.id] > 0) {
+                isr_depth[r.id]--;
+
+            } else {
+                // entry was before the start of the dump
+                break;
+            }
+
+            emit("\"name\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f",
+                 name, (r.event == Trace::EV_ISR_ENTER) ? "B" : "E", TID_ISR + r.id, us);
+        }
+        break;
+
+        case Trace::EV_PACKET:
+            emit("\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"count\":%u}",
+                 r.id ? "bad packet" : "packet", TID_PACKETS, us, r.data);
+            break;
+
+        case Trace::EV_FRAME:
+            emit("\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%u,\"args\":{\"pages\":\"0x%02x\"}",
+                 TID_FRAMES, us - r.data, r.data, r.id);
+            break;
+
+        default:
+            fprintf(stderr, "unknown event %u\n", r.event);
+            break;
+        }
+    }
+
+    printf("\n]}\n");
+    fprintf(stderr, "%zu records, %.3f ms\n", records.size(), (double)now / cycles_per_us / 1000);
+    return 0;
+}
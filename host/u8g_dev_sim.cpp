@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file u8g_dev_sim.cpp
+ *
+ * Simulated display for host builds.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "board.h"
+#include "u8g_dev_sim.h"
+
+namespace Sim
+{
+
+unsigned frames;
+unsigned mismatches;
+
+namespace
+{
+
+/** display controller RAM */
+uint8_t gdram[pages][width];
+
+const char *frame_dir;
+const char *golden_dir;
+shm_frame *shm;
+
+const unsigned pbm_row_bytes = width / 8;
+
+/**
+ * Convert display RAM to PBM raster order.
+ */
+void
+gdram_to_pbm(uint8_t *raster)
+{
+    memset(raster, 0, pbm_row_bytes * height);
+
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x++) {
+            if (gdram[y / page_height][x] & (1 << (y % page_height)))
+                raster[y * pbm_row_bytes + x / 8] |= 0x80 >> (x % 8);
+        }
+    }
+}
+
+void
+frame_path(char *path, size_t len, const char *dir)
+{
+    snprintf(path, len, "%s/frame-%06u.pbm", dir, frames);
+}
+
+void
+write_frame(const uint8_t *raster)
+{
+    char path[256];
+    frame_path(path, sizeof(path), frame_dir);
+
+    auto fp = fopen(path, "wb");
+
+    if (fp == nullptr) {
+        perror(path);
+        return;
+    }
+
+    fprintf(fp, "P4\n%u %u\n", width, height);
+    fwrite(raster, pbm_row_bytes, height, fp);
+    fclose(fp);
+}
+
+void
+compare_frame(const uint8_t *raster)
+{
+    char path[256];
+    frame_path(path, sizeof(path), golden_dir);
+
+    uint8_t golden[pbm_row_bytes * height];
+    unsigned w, h;
+    bool match = false;
+    auto fp = fopen(path, "rb");
+
+    if (fp != nullptr) {
+        match = (fscanf(fp, "P4 %u %u", &w, &h) == 2) &&
+                (w == width) && (h == height) &&
+                (fgetc(fp) != EOF) &&
+                (fread(golden, sizeof(golden), 1, fp) == 1) &&
+                !memcmp(golden, raster, sizeof(golden));
+        fclose(fp);
+    }
+
+    if (!match) {
+        if (mismatches++ < 10)
+            fprintf(stderr, "frame %u does not match %s\n", frames, path);
+    }
+}
+
+/**
+ * Called once the last page of a frame has been sent.
+ */
+void
+frame_done()
+{
+    if (shm != nullptr) {
+        // odd while writing; the fence keeps the copy after the increment
+        __atomic_add_fetch(&shm->sequence, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(shm->gdram, gdram, sizeof(gdram));
+        __atomic_add_fetch(&shm->sequence, 1, __ATOMIC_RELEASE);
+    }
+
+    if ((frame_dir != nullptr) || (golden_dir != nullptr)) {
+        uint8_t raster[pbm_row_bytes * height];
+
+        gdram_to_pbm(raster);
+
+        if (frame_dir != nullptr)
+            write_frame(raster);
+
+        if (golden_dir != nullptr)
+            compare_frame(raster);
+    }
+
+    frames++;
+}
+
+/**
+ * Copy the display pages in [first_page, first_page + count) that the
+ * board wants sent into display RAM.
+ */
+void
+send_pages(const uint8_t *buf, unsigned first_page, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        auto page = first_page + i;
+
+        /* leave clean pages alone, as the panel driver does */
+        if (gBoard->display_page_mask & (1 << page))
+            memcpy(gdram[page], buf + i * width, width);
+    }
+}
+
+uint8_t
+com_fn(u8g_t *u8g __unused, uint8_t msg __unused, uint8_t arg_val __unused, void *arg_ptr __unused)
+{
+    return 1;
+}
+
+/****************************************************************************
+ * Page buffer device
+ *
+ * Uses the same 8-line page buffer as the target, so the drawing code
+ * makes the same number of passes.
+ */
+
+uint8_t
+page_dev_fn(u8g_t *u8g, u8g_dev_t *dev, uint8_t msg, void *arg)
+{
+    switch (msg) {
+    case U8G_DEV_MSG_INIT:
+        memset(gdram, 0, sizeof(gdram));
+        break;
+
+    case U8G_DEV_MSG_PAGE_NEXT: {
+        u8g_pb_t *pb = (u8g_pb_t *)(dev->dev_mem);
+
+        send_pages((const uint8_t *)pb->buf, pb->p.page, 1);
+
+        if ((pb->p.page_y1 + 1U) >= pb->p.total_height)
+            frame_done();
+    }
+    break;
+    }
+
+    return u8g_dev_pb8v1_base_fn(u8g, dev, msg, arg);
+}
+
+/****************************************************************************
+ * Full frame buffer device
+ *
+ * One page covers the whole display; the buffer uses the controller's
+ * layout so pages can be sent straight from it.
+ */
+
+uint8_t frame_buf[pages * width];
+
+void
+frame_set_pixel(u8g_pb_t *pb, u8g_dev_arg_pixel_t *arg_pixel)
+{
+    if ((arg_pixel->x >= pb->width) || (arg_pixel->y >= pb->p.total_height))
+        return;
+
+    uint8_t *ptr = (uint8_t *)pb->buf + (arg_pixel->y / page_height) * width + arg_pixel->x;
+    uint8_t mask = 1 << (arg_pixel->y % page_height);
+
+    if (arg_pixel->color) {
+        *ptr |= mask;
+
+    } else {
+        *ptr &= ~mask;
+    }
+}
+
+void
+frame_set_8pixel(u8g_pb_t *pb, u8g_dev_arg_pixel_t *arg_pixel)
+{
+    uint8_t pixel = arg_pixel->pixel;
+    u8g_uint_t dx = 0;
+    u8g_uint_t dy = 0;
+
+    switch (arg_pixel->dir) {
+    case 0: dx++; break;
+
+    case 1: dy++; break;
+
+    case 2: dx--; break;
+
+    case 3: dy--; break;
+    }
+
+    do {
+        if (pixel & 0x80)
+            frame_set_pixel(pb, arg_pixel);
+
+        arg_pixel->x += dx;
+        arg_pixel->y += dy;
+        pixel <<= 1;
+    } while (pixel != 0);
+}
+
+uint8_t
+frame_dev_fn(u8g_t *u8g, u8g_dev_t *dev, uint8_t msg, void *arg)
+{
+    u8g_pb_t *pb = (u8g_pb_t *)(dev->dev_mem);
+
+    switch (msg) {
+    case U8G_DEV_MSG_INIT:
+        memset(gdram, 0, sizeof(gdram));
+        break;
+
+    case U8G_DEV_MSG_PAGE_FIRST:
+        memset(pb->buf, 0, sizeof(frame_buf));
+        u8g_page_First(&pb->p);
+        return 1;
+
+    case U8G_DEV_MSG_PAGE_NEXT:
+        send_pages((const uint8_t *)pb->buf, 0, pages);
+        frame_done();
+        return u8g_page_Next(&pb->p);
+
+    case U8G_DEV_MSG_SET_PIXEL:
+        frame_set_pixel(pb, (u8g_dev_arg_pixel_t *)arg);
+        return 1;
+
+    case U8G_DEV_MSG_SET_8PIXEL:
+        frame_set_8pixel(pb, (u8g_dev_arg_pixel_t *)arg);
+        return 1;
+    }
+
+    /* page box, intersection, size and mode queries are generic */
+    return u8g_dev_pb8v1_base_fn(u8g, dev, msg, arg);
+}
+
+u8g_pb_t frame_pb = { { height, height, 0, 0, 0 }, width, frame_buf };
+
+} // namespace
+
+U8G_PB_DEV(u8g_dev_sim_page, width, height, page_height, page_dev_fn, com_fn);
+
+u8g_dev_t u8g_dev_sim_frame = { frame_dev_fn, &frame_pb, com_fn };
+
+void
+set_frame_dir(const char *dir)
+{
+    frame_dir = dir;
+}
+
+void
+set_golden_dir(const char *dir)
+{
+    golden_dir = dir;
+}
+
+bool
+set_shm(const char *name)
+{
+    auto fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0) {
+        perror(name);
+        return false;
+    }
+
+    if (ftruncate(fd, sizeof(shm_frame)) < 0) {
+        perror(name);
+        close(fd);
+        return false;
+    }
+
+    auto p = mmap(nullptr, sizeof(shm_frame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED) {
+        perror(name);
+        return false;
+    }
+
+    shm = (shm_frame *)p;
+    shm->frame_width = width;
+    shm->frame_height = height;
+    shm->sequence = 0;
+    shm->magic = shm_magic;
+    return true;
+}
+
+} // namespace Sim
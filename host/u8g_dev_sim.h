@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file u8g_dev_sim.h
+ *
+ * Simulated display for host builds.
+ *
+ * Both devices keep a copy of the display controller RAM, updated the way
+ * the real panel would be, and hand each completed frame to the configured
+ * outputs.
+ */
+
+#pragma once
+
+#include <u8g.h>
+
+namespace Sim
+{
+
+const unsigned width = 128;
+const unsigned height = 64;
+const unsigned page_height = 8;
+const unsigned pages = height / page_height;
+
+/** 8-line page buffer, as used on the target */
+extern u8g_dev_t u8g_dev_sim_page;
+
+/** full frame buffer, drawn in a single pass */
+extern u8g_dev_t u8g_dev_sim_frame;
+
+/**
+ * Write each frame to a numbered PBM file.
+ *
+ * @param dir               Directory for frame-NNNNNN.pbm files.
+ */
+extern void set_frame_dir(const char *dir);
+
+/**
+ * Compare each frame with a numbered PBM file.
+ *
+ * @param dir               Directory holding frame-NNNNNN.pbm files from
+ *                          a previous run.
+ */
+extern void set_golden_dir(const char *dir);
+
+/**
+ * Publish frames through POSIX shared memory.
+ *
+ * The object holds a shm_frame that is updated after each frame.
+ *
+ * @param name              Name of the shared memory object.
+ * @return                  True if the object was created and mapped.
+ */
+extern bool set_shm(const char *name);
+
+struct shm_frame {
+    uint32_t    magic;                      ///< shm_magic once initialised
+    uint32_t    sequence;                   ///< odd while the frame is being updated
+    uint16_t    frame_width, frame_height;
+    uint8_t     gdram[pages][width];        ///< display RAM, one byte covers 8 rows
+};
+
+const uint32_t shm_magic = 0x45424c31;     // 'EBL1'
+
+/** number of frames sent to the display */
+extern unsigned frames;
+
+/** number of frames that did not match the golden images */
+extern unsigned mismatches;
+
+} // namespace Sim
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file uisim.cpp
+ *
+ * Replay an EBL capture through the decoder and user interface, drawing
+ * to a simulated display and measuring how long UI::tick() takes.
+ *
+ * Time is simulated: capture bytes arrive at the serial line rate, the
+ * system tick advances once per millisecond of line time and the UI is
+ * ticked every 10ms as the GUI process does on the target. The capture
+ * is replayed as fast as the host can manage.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "board_host.h"
+#include "u8g_dev_sim.h"
+
+/*
+ * The kernel expects every process slot to be filled; nothing is scheduled
+ * on the host so these never run.
+ */
+typedef OS::process<OS::pr0, 256> TProc0;
+typedef OS::process<OS::pr1, 256> TProc1;
+typedef OS::process<OS::pr2, 256> TProc2;
+
+TProc0 Proc0;
+TProc1 Proc1;
+TProc2 Proc2;
+
+namespace OS
+{
+template <> OS_PROCESS void TProc0::exec() { for (;;); }
+template <> OS_PROCESS void TProc1::exec() { for (;;); }
+template <> OS_PROCESS void TProc2::exec() { for (;;); }
+}
+
+namespace
+{
+
+const unsigned ui_period = 10;          // ms, as GUIProc
+const unsigned key_hold = 100;          // ms a scripted key is held down
+const unsigned drain_time = 2000;       // ms run after the end of the capture
+
+struct KeyPress {
+    unsigned    at;                     // ms from start
+    uint8_t     key;
+};
+
+std::vector<KeyPress> keys;
+std::vector<unsigned> tick_ns;          // every UI tick
+std::vector<unsigned> frame_ns;         // UI ticks that drew a frame
+
+unsigned now_ms;
+unsigned next_ui;
+unsigned key_up;
+
+uint64_t
+host_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void
+usage()
+{
+    fprintf(stderr,
+            "usage: uisim [options] <capture>\n"
+            "  -f          full frame buffer (default is 8-line pages)\n"
+            "  -o <dir>    write frames as PBM images\n"
+            "  -g <dir>    compare frames with PBM images from a previous run\n"
+            "  -s <name>   publish frames through POSIX shared memory\n"
+            "  -b <baud>   serial line rate (default 57600)\n"
+            "  -l <n>      replay the capture n times\n"
+            "  -k <keys>   key presses, <ms>:<s|p|n>[,...]\n");
+    exit(1);
+}
+
+bool
+parse_keys(const char *arg)
+{
+    while (*arg != '\0') {
+        char *end;
+        KeyPress kp;
+
+        kp.at = strtoul(arg, &end, 10);
+
+        if ((end == arg) || (*end++ != ':'))
+            return false;
+
+        switch (*end++) {
+        case 's': kp.key = M2_KEY_SELECT; break;
+
+        case 'p': kp.key = M2_KEY_PREV; break;
+
+        case 'n': kp.key = M2_KEY_NEXT; break;
+
+        default:
+            return false;
+        }
+
+        keys.push_back(kp);
+
+        if (*end == ',')
+            end++;
+
+        arg = end;
+    }
+
+    std::sort(keys.begin(), keys.end(),
+    [](const KeyPress & a, const KeyPress & b) { return a.at < b.at; });
+    return true;
+}
+
+/**
+ * Run one millisecond of simulated time.
+ */
+void
+tick_ms()
+{
+    now_ms++;
+    OS::sys_tick_handler();
+
+    if ((key_up != 0) && (now_ms >= key_up)) {
+        board_host.key = M2_KEY_NONE;
+        key_up = 0;
+    }
+
+    if (!keys.empty() && (now_ms >= keys.front().at)) {
+        board_host.key = keys.front().key;
+        key_up = now_ms + key_hold;
+        keys.erase(keys.begin());
+    }
+
+    if (now_ms >= next_ui) {
+        auto frames = Sim::frames;
+        auto start = host_ns();
+
+        UI::tick();
+
+        auto ns = host_ns() - start;
+        tick_ns.push_back(ns);
+
+        if (Sim::frames != frames)
+            frame_ns.push_back(ns);
+
+        next_ui += ui_period;
+    }
+}
+
+void
+report(const char *what, std::vector<unsigned> &v)
+{
+    if (v.empty()) {
+        printf("%-6s     0\n", what);
+        return;
+    }
+
+    std::sort(v.begin(), v.end());
+    uint64_t total = 0;
+
+    for (auto ns : v)
+        total += ns;
+
+    printf("%-6s %6zu  mean %7.1f  p50 %7.1f  p99 %7.1f  max %7.1f us\n",
+           what, v.size(),
+           total / 1000.0 / v.size(),
+           v[v.size() / 2] / 1000.0,
+           v[(v.size() * 99) / 100] / 1000.0,
+           v.back() / 1000.0);
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    unsigned baud = 57600;
+    unsigned loops = 1;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "fo:g:s:b:l:k:")) != -1) {
+        switch (ch) {
+        case 'f':
+            board_host.set_display(&Sim::u8g_dev_sim_frame);
+            break;
+
+        case 'o':
+            Sim::set_frame_dir(optarg);
+            break;
+
+        case 'g':
+            Sim::set_golden_dir(optarg);
+            break;
+
+        case 's':
+            if (!Sim::set_shm(optarg))
+                return 1;
+
+            break;
+
+        case 'b':
+            baud = strtoul(optarg, nullptr, 0);
+            break;
+
+        case 'l':
+            loops = strtoul(optarg, nullptr, 0);
+            break;
+
+        case 'k':
+            if (!parse_keys(optarg))
+                usage();
+
+            break;
+
+        default:
+            usage();
+        }
+    }
+
+    if ((optind != (argc - 1)) || (baud == 0) || (loops == 0))
+        usage();
+
+    auto fp = fopen(argv[optind], "rb");
+
+    if (fp == nullptr) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    std::vector<uint8_t> capture;
+    int c;
+
+    while ((c = fgetc(fp)) != EOF)
+        capture.push_back(c);
+
+    fclose(fp);
+
+    UI::init();
+
+    /* 10 bits per byte on the wire */
+    const double byte_ms = 10000.0 / baud;
+    double line_ms = 0;
+    auto start = host_ns();
+
+    for (unsigned loop = 0; loop < loops; loop++) {
+        for (auto b : capture) {
+            line_ms += byte_ms;
+
+            while (now_ms < line_ms)
+                tick_ms();
+
+            EBL::decode(b);
+        }
+    }
+
+    for (unsigned i = 0; i < drain_time; i++)
+        tick_ms();
+
+    auto elapsed = (host_ns() - start) / 1e9;
+
+    printf("%zu bytes x %u, %u good / %u bad packets, %u frames\n",
+           capture.size(), loops, EBL::good_packets, EBL::bad_packets, Sim::frames);
+    printf("%.1fs simulated in %.2fs (%.0fx real time)\n",
+           now_ms / 1000.0, elapsed, now_ms / 1000.0 / elapsed);
+    report("tick", tick_ns);
+    report("frame", frame_ns);
+
+    if (Sim::mismatches) {
+        printf("%u frames differ from the golden images\n", Sim::mismatches);
+        return 1;
+    }
+
+    return 0;
+}
@@ -201,6 +201,78 @@ void OS::TBaseProcess::force_wake_up()
     Kernel.scheduler();
 }
 //------------------------------------------------------------------------------
+#if scmRTOS_TICKLESS_IDLE_ENABLE == 1
+//
+//    Tickless idle support, call with interrupts disabled
+//
+#if scmRTOS_PRIORITY_ORDER == 0
+    const uint_fast8_t TicklessBaseIndex = 0;
+#else
+    const uint_fast8_t TicklessBaseIndex = 1;
+#endif
+
+//
+//    Shortest timeout of any sleeping process or of the system timer
+//    hook, 0 if there is none
+//
+timeout_t TKernel::nearest_timeout() const
+{
+    timeout_t Nearest = 0;
+
+    for(uint_fast8_t i = TicklessBaseIndex; i < (PROCESS_COUNT - 1 + TicklessBaseIndex); i++)
+    {
+        timeout_t t = ProcessTable[i]->Timeout;
+
+        if(t && (!Nearest || (t < Nearest)))
+        {
+            Nearest = t;
+        }
+    }
+
+#if scmRTOS_SYSTIMER_HOOK_ENABLE == 1
+    timeout_t t = system_timer_user_nearest();
+
+    if(t && (!Nearest || (t < Nearest)))
+    {
+        Nearest = t;
+    }
+#endif
+    return Nearest;
+}
+//------------------------------------------------------------------------------
+//
+//    Account for ticks that passed while the system timer was stopped
+//
+void TKernel::advance_system_timer(timeout_t Ticks)
+{
+#if scmRTOS_SYSTEM_TICKS_ENABLE == 1
+    SysTickCount += Ticks;
+#endif
+
+    for(uint_fast8_t i = TicklessBaseIndex; i < (PROCESS_COUNT - 1 + TicklessBaseIndex); i++)
+    {
+        TBaseProcess* p = ProcessTable[i];
+
+        if(p->Timeout > 0)
+        {
+            if(p->Timeout <= Ticks)
+            {
+                p->Timeout = 0;
+                set_process_ready(p->Priority);
+            }
+            else
+            {
+                p->Timeout -= Ticks;
+            }
+        }
+    }
+
+#if scmRTOS_SYSTIMER_HOOK_ENABLE == 1
+    system_timer_user_advance(Ticks);
+#endif
+}
+#endif // scmRTOS_TICKLESS_IDLE_ENABLE
+//------------------------------------------------------------------------------
 //
 //
 //   Idle Process
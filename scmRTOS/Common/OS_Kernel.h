@@ -134,6 +134,9 @@ namespace OS
         
         friend void                 run();
         friend const TBaseProcess * get_proc(uint_fast8_t Prio);
+    #if scmRTOS_TARGET_IDLE_HOOK_ENABLE == 1
+        friend void                 idle_process_target_hook();
+    #endif
     #if scmRTOS_SYSTEM_TICKS_ENABLE == 1
         friend inline tick_count_t  get_tick_count();
     #endif
@@ -186,6 +189,12 @@ namespace OS
         INLINE void set_process_ready  (const uint_fast8_t pr) { TProcessMap PrioTag = get_prio_tag(pr); set_prio_tag( ReadyProcessMap, PrioTag); }
         INLINE void set_process_unready(const uint_fast8_t pr) { TProcessMap PrioTag = get_prio_tag(pr); clr_prio_tag( ReadyProcessMap, PrioTag); }
 
+    #if scmRTOS_TICKLESS_IDLE_ENABLE == 1
+        INLINE bool only_idle_ready() const { return ReadyProcessMap == get_prio_tag(prIDLE); }
+               timeout_t nearest_timeout() const;
+               void advance_system_timer(timeout_t Ticks);
+    #endif
+
     public:
         INLINE void system_timer();
     #if scmRTOS_CONTEXT_SWITCH_SCHEME == 1
@@ -510,6 +519,14 @@ namespace OS
 
 #if scmRTOS_SYSTIMER_HOOK_ENABLE == 1
     INLINE_SYS_TIMER_HOOK void system_timer_user_hook();
+
+#if scmRTOS_TICKLESS_IDLE_ENABLE == 1
+    // Work driven by the system timer hook also bounds tickless sleeps:
+    // ticks until the hook next has something to do (0 if nothing), and
+    // the ticks skipped while the system timer was stopped.
+    timeout_t system_timer_user_nearest();
+    void      system_timer_user_advance(timeout_t Ticks);
+#endif // scmRTOS_TICKLESS_IDLE_ENABLE
 #endif // scmRTOS_SYSTIMER_HOOK_ENABLE
 
 #if scmRTOS_CONTEXT_SWITCH_USER_HOOK_ENABLE == 1
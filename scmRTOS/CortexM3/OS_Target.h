@@ -140,6 +140,11 @@ typedef uint32_t status_reg_t;
 //
 #include "scmRTOS_CONFIG.h"
 #include "scmRTOS_TARGET_CFG.h"
+
+#if scmRTOS_TICKLESS_IDLE_ENABLE == 1
+#define scmRTOS_TARGET_IDLE_HOOK_ENABLE 1
+#endif
+
 #include <scmRTOS_defs.h>
 
 //-----------------------------------------------------------------------------
@@ -192,6 +197,33 @@ INLINE void DisableInterrupts() { disable_interrupts(); }
 //     The Critical Section Wrapper
 //
 //
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE == 1
+namespace OS
+{
+    // Called with interrupts masked. The enter hook identifies the critical
+    // section by its return address, so it must not be inlined.
+    NOINLINE void critsect_enter_user_hook();
+    void critsect_exit_user_hook();
+}
+
+class TCritSect
+{
+public:
+    INLINE TCritSect () : StatusReg(get_interrupt_state())
+    {
+        disable_interrupts();
+        if(StatusReg == 0) OS::critsect_enter_user_hook();
+    }
+    INLINE ~TCritSect()
+    {
+        if(StatusReg == 0) OS::critsect_exit_user_hook();
+        set_interrupt_state(StatusReg);
+    }
+
+private:
+    status_reg_t StatusReg;
+};
+#else
 class TCritSect
 {
 public:
@@ -201,6 +233,7 @@ public:
 private:
     status_reg_t StatusReg;
 };
+#endif // scmRTOS_CRITSECT_USER_HOOK_ENABLE
 
 
 //-----------------------------------------------------------------------------
@@ -236,14 +269,53 @@ INLINE OS::TProcessMap get_prio_tag(const uint_fast8_t pr) { return static_cast<
 
 namespace OS
 {
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE == 1
+    // The scheduler briefly unmasks interrupts inside its critical section
+    // to let PendSV switch processes; that ends the masked span.
+    INLINE void enable_context_switch()  { critsect_exit_user_hook(); enable_interrupts(); }
+    INLINE void disable_context_switch() { disable_interrupts(); critsect_enter_user_hook(); }
+#else
     INLINE void enable_context_switch()  { enable_interrupts(); }
     INLINE void disable_context_switch() { disable_interrupts(); }
+#endif // scmRTOS_CRITSECT_USER_HOOK_ENABLE
 }
 
 #include <OS_Kernel.h>
 
 namespace OS
 {
+#if scmRTOS_TICKLESS_IDLE_ENABLE == 1
+    //--------------------------------------------------------------------------
+    //
+    //      Tickless idle statistics, all times in core clock cycles
+    //
+    struct TTicklessStats
+    {
+        uint32_t Sleeps;            // times the idle process slept
+        uint32_t LongSleeps;        // sleeps with the tick stopped
+        uint32_t EarlyWakes;        // long sleeps ended by an interrupt
+        uint32_t TicksSkipped;      // tick interrupts that did not happen
+        uint32_t SleepCycles;       // time spent sleeping, wraps
+        uint32_t WakeLatencyMax;    // timer expiry to idle process running
+        uint32_t WakeLatencySum;
+        uint32_t WakeLatencyCount;
+    };
+
+    extern TTicklessStats tickless_stats;
+#endif // scmRTOS_TICKLESS_IDLE_ENABLE
+
+#if scmRTOS_ISRW_USER_HOOK_ENABLE == 1
+    INLINE uint_fast8_t get_active_exception()
+    {
+        uint32_t ipsr;
+        __asm__ __volatile__ ("MRS %0, IPSR" : "=r"(ipsr) );
+        return ipsr & 0x1ff;
+    }
+
+    void isrw_enter_user_hook(uint_fast8_t exception);
+    void isrw_exit_user_hook(uint_fast8_t exception);
+#endif // scmRTOS_ISRW_USER_HOOK_ENABLE
+
     //--------------------------------------------------------------------------
     //
     //      NAME       :   OS ISR support
@@ -266,11 +338,17 @@ namespace OS
         {
             TCritSect cs;
             Kernel.ISR_NestCount++;
+        #if scmRTOS_ISRW_USER_HOOK_ENABLE == 1
+            isrw_enter_user_hook(get_active_exception());
+        #endif
         }
         //-----------------------------------------------------
         INLINE void ISR_Exit()
         {
             TCritSect cs;
+        #if scmRTOS_ISRW_USER_HOOK_ENABLE == 1
+            isrw_exit_user_hook(get_active_exception());
+        #endif
             if(--Kernel.ISR_NestCount) return;
             Kernel.sched_isr();
         }
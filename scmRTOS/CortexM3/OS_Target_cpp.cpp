@@ -86,3 +86,139 @@ OS_INTERRUPT void OS::sys_tick_handler()
 }
 //------------------------------------------------------------------------------
 
+#if scmRTOS_TICKLESS_IDLE_ENABLE == 1
+//------------------------------------------------------------------------------
+//
+//    Tickless idle
+//
+//    With only the idle process ready, stop the tick and sleep until the
+//    nearest process timeout. SysTick keeps counting core clocks while the
+//    core sleeps, so it also measures how long the sleep lasted; the ticks
+//    that were skipped are accounted for on wake-up. A few cycles are lost
+//    each time the counter is stopped and restarted.
+//
+TTicklessStats OS::tickless_stats;
+
+void OS::idle_process_target_hook()
+{
+    const uint32_t Period   = SYSTICKFREQ / SYSTICKINTRATE;
+    const uint32_t MaxTicks = 0x00FFFFFF / Period;
+
+    // WFI wakes on a pending interrupt even with interrupts masked;
+    // the handler runs when the critical section ends.
+    TCritSect cs;
+
+    if(!Kernel.only_idle_ready()) return;
+
+    uint32_t Ticks = Kernel.nearest_timeout();
+    if((Ticks == 0) || (Ticks > MaxTicks))
+        Ticks = MaxTicks;
+
+    (void)*CPU_SYSTICKCSR;                      // clear COUNTFLAG
+    uint32_t Remaining = *CPU_SYSTICKCVR;       // cycles to the next tick
+    uint32_t Reload = 0;
+
+    if(Ticks > 1)
+    {
+        *CPU_SYSTICKCSR &= ~CPU_SYSTICKCSR_EN;
+        Remaining = *CPU_SYSTICKCVR;
+
+        if((*CPU_ICSR & CPU_ICSR_PENDSTSET) || (Remaining < 2))
+        {
+            // a tick is due now, take it first
+            *CPU_SYSTICKCSR |= CPU_SYSTICKCSR_EN;
+            return;
+        }
+
+        // first wrap comes Reload + 1 cycles after the counter is cleared
+        Reload = Remaining + (Ticks - 1) * Period - 1;
+        *CPU_SYSTICKRVR = Reload;
+        *CPU_SYSTICKCVR = 0;
+        *CPU_SYSTICKCSR |= CPU_SYSTICKCSR_EN;
+    }
+
+    // time asleep doesn't delay interrupts; one wakes the core at once
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE == 1
+    critsect_exit_user_hook();
+#endif
+
+    __asm__ __volatile__ ("dsb\n\twfi\n\tisb" : : : "memory");
+
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE == 1
+    critsect_enter_user_hook();
+#endif
+
+    uint32_t Now = *CPU_SYSTICKCVR;
+    bool Wrapped = (*CPU_SYSTICKCSR & CPU_SYSTICKCSR_CNTF) != 0;
+
+    // a wrap between the two reads leaves Now from before the reload
+    if(Wrapped)
+        Now = *CPU_SYSTICKCVR;
+    uint32_t Elapsed;
+
+    if(Ticks > 1)
+    {
+        *CPU_SYSTICKCSR &= ~CPU_SYSTICKCSR_EN;
+
+        Elapsed = Reload - Now;
+        if(Wrapped)
+            Elapsed += Reload + 1;
+
+        // tick boundaries passed while asleep, and cycles to the next one
+        uint32_t Passed = 0;
+        uint32_t ToNext = Remaining - Elapsed;
+        if(Elapsed >= Remaining)
+        {
+            Passed = 1 + (Elapsed - Remaining) / Period;
+            ToNext = Period - (Elapsed - Remaining) % Period;
+        }
+
+        // the pending SysTick interrupt accounts for the tick at the wrap
+        uint32_t Skipped = Wrapped ? Passed - 1 : Passed;
+
+        if(ToNext < 2)
+        {
+            ToNext += Period;
+            Skipped++;
+        }
+
+        Kernel.advance_system_timer(Skipped);
+
+        // restart on the tick boundary; the normal period applies after the next reload
+        *CPU_SYSTICKRVR = ToNext - 1;
+        *CPU_SYSTICKCVR = 0;
+        *CPU_SYSTICKCSR |= CPU_SYSTICKCSR_EN;
+        *CPU_SYSTICKRVR = Period - 1;
+
+        tickless_stats.LongSleeps++;
+        tickless_stats.TicksSkipped += Skipped;
+        if(!Wrapped)
+            tickless_stats.EarlyWakes++;
+    }
+    else
+    {
+        Elapsed = Remaining - Now;
+        if(Wrapped)
+            Elapsed += Period;
+    }
+
+    if(Wrapped)
+    {
+        // the timer expired at the wrap, the counter has run on since
+        uint32_t Latency = ((Ticks > 1) ? Reload : (Period - 1)) - Now;
+
+        if(Latency > tickless_stats.WakeLatencyMax)
+            tickless_stats.WakeLatencyMax = Latency;
+        tickless_stats.WakeLatencySum += Latency;
+        tickless_stats.WakeLatencyCount++;
+    }
+
+    tickless_stats.Sleeps++;
+    tickless_stats.SleepCycles += Elapsed;
+
+    // run anything whose timeout expired while the tick was stopped
+    if(!Kernel.only_idle_ready())
+        Kernel.scheduler();
+}
+#endif // scmRTOS_TICKLESS_IDLE_ENABLE
+//------------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+//******************************************************************************
+//*
+//*     FULLNAME:  Single-Chip Microcontroller Real-Time Operating System
+//*
+//*     NICKNAME:  scmRTOS
+//*
+//*     PURPOSE:  Event Group - wait for any or all of several events
+//*
+//*     Version: 4.00
+//*
+//*
+//*     Copyright (c) 2003-2012, Harry E. Zhurov
+//*
+//*     Permission is hereby granted, free of charge, to any person
+//*     obtaining  a copy of this software and associated documentation
+//*     files (the "Software"), to deal in the Software without restriction,
+//*     including without limitation the rights to use, copy, modify, merge,
+//*     publish, distribute, sublicense, and/or sell copies of the Software,
+//*     and to permit persons to whom the Software is furnished to do so,
+//*     subject to the following conditions:
+//*
+//*     The above copyright notice and this permission notice shall be included
+//*     in all copies or substantial portions of the Software.
+//*
+//*     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//*     EXPRESS  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//*     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//*     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//*     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//*     TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+//*     THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//*
+//*     =================================================================
+//*     See http://scmrtos.sourceforge.net for documentation, latest
+//*     information, license and contact details.
+//*     =================================================================
+//*
+//*****************************************************************************
+//*     Event group extension for EBLmon
+
+
+#ifndef EVENT_GROUP_H
+#define EVENT_GROUP_H
+
+#include <scmRTOS.h>
+
+namespace OS
+{
+    //--------------------------------------------------------------------------
+    //
+    //   Event Group
+    //
+    //   A set of event bits that a process can wait on, for any or all of
+    //   a mask of them, with a timeout
+    //
+    //       DESCRIPTION:
+    //
+    //   signal() / signal_isr() set bits and wake every waiting process;
+    //   each waiter re-checks its own mask and goes back to sleep if it is
+    //   not yet satisfied, with whatever remains of its timeout. Signalling
+    //   costs the same as TEventFlag::signal_isr(). The events that satisfy
+    //   a wait are cleared by it.
+    //
+    class TEventGroup : public TService
+    {
+    public:
+        typedef uint32_t TBits;
+
+    public:
+        INLINE TEventGroup(TBits init_val = 0) : ProcessMap(0), Value(init_val) { }
+
+        // return the events that fired, 0 on timeout
+        INLINE TBits wait_any(TBits mask, timeout_t timeout = 0) { return wait(mask, false, timeout); }
+        INLINE TBits wait_all(TBits mask, timeout_t timeout = 0) { return wait(mask, true, timeout);  }
+
+        INLINE void  signal(TBits bits);
+        INLINE void  signal_isr(TBits bits);
+        INLINE void  clear(TBits bits) { TCritSect cs; Value &= ~bits; }
+        INLINE TBits value() const     { return Value; }
+
+    protected:
+               TBits wait(TBits mask, bool all, timeout_t timeout);
+
+        volatile TProcessMap ProcessMap;
+        volatile TBits       Value;
+    };
+    //--------------------------------------------------------------------------
+
+    inline OS::TEventGroup::TBits OS::TEventGroup::wait(TBits mask, bool all, timeout_t timeout)
+    {
+        TCritSect cs;
+
+        cur_proc_timeout() = timeout;
+
+        for(;;)
+        {
+            TBits Fired = Value & mask;
+            if( all ? (Fired == mask) : (Fired != 0) )
+            {
+                Value &= ~Fired;                                // consume the events that satisfied the wait
+                cur_proc_timeout() = 0;
+                return Fired;
+            }
+
+            suspend(ProcessMap);                                // timeout keeps counting down across wake-ups
+
+            if(is_timeouted(ProcessMap))
+                return 0;                                       // waked up by timeout or by externals
+        }
+    }
+    //--------------------------------------------------------------------------
+    void OS::TEventGroup::signal(TBits bits)
+    {
+        TCritSect cs;
+        Value |= bits;
+        resume_all(ProcessMap);                                 // waiters check their own masks
+    }
+    //--------------------------------------------------------------------------
+    void OS::TEventGroup::signal_isr(TBits bits)
+    {
+        TCritSect cs;
+        Value |= bits;
+        resume_all_isr(ProcessMap);
+    }
+    //--------------------------------------------------------------------------
+}
+
+#endif // EVENT_GROUP_H
+//-----------------------------------------------------------------------------
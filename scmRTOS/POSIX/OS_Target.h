@@ -0,0 +1,255 @@
+//******************************************************************************
+//*
+//*     FULLNAME:  Single-Chip Microcontroller Real-Time Operating System
+//*
+//*     NICKNAME:  scmRTOS
+//*
+//*     PROCESSOR: POSIX host
+//*
+//*     TOOLKIT:   GCC / Clang
+//*
+//*     PURPOSE:   Target Dependent Stuff Header. Declarations And Definitions
+//*
+//*     Version: 4.00
+//*
+//*     Copyright (c) 2003-2012, Harry E. Zhurov
+//*
+//*     Permission is hereby granted, free of charge, to any person
+//*     obtaining  a copy of this software and associated documentation
+//*     files (the "Software"), to deal in the Software without restriction,
+//*     including without limitation the rights to use, copy, modify, merge,
+//*     publish, distribute, sublicense, and/or sell copies of the Software,
+//*     and to permit persons to whom the Software is furnished to do so,
+//*     subject to the following conditions:
+//*
+//*     The above copyright notice and this permission notice shall be included
+//*     in all copies or substantial portions of the Software.
+//*
+//*     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//*     EXPRESS  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//*     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//*     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//*     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//*     TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+//*     THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//*
+//*     =================================================================
+//*     See http://scmrtos.sourceforge.net for documentation, latest
+//*     information, license and contact details.
+//*     =================================================================
+//*
+//******************************************************************************
+//*     POSIX host port for EBLmon host tools
+
+#ifndef scmRTOS_POSIX_H
+#define scmRTOS_POSIX_H
+
+#include <signal.h>
+
+//------------------------------------------------------------------------------
+//
+//    Compiler and Target checks
+//
+//
+#ifndef __GNUC__
+#error "This file should only be compiled with GNU C++ Compiler"
+#endif // __GNUC__
+
+//------------------------------------------------------------------------------
+//
+//    Compiler specific attributes
+//
+//
+#ifndef INLINE
+#define INLINE      __attribute__((__always_inline__)) inline
+#endif
+
+#ifndef NOINLINE
+#define NOINLINE    __attribute__((__noinline__))
+#endif
+
+#ifndef NORETURN
+#define NORETURN    __attribute__((__noreturn__))
+#endif
+
+//------------------------------------------------------------------------------
+//
+//    Target specific types
+//
+//
+typedef uintptr_t stack_item_t;
+typedef int       status_reg_t;
+
+//-----------------------------------------------------------------------------
+//
+//    Configuration macros
+//
+//
+#define OS_PROCESS __attribute__((__noreturn__))
+#define OS_INTERRUPT extern "C"
+
+#define DUMMY_INSTR() do { } while (0)
+#define INLINE_PROCESS_CTOR INLINE
+
+#define SYS_TIMER_CRIT_SECT()  TCritSect cs
+
+#define SEPARATE_RETURN_STACK   0
+
+#define scmRTOS_ISRW_TYPE       TISRW
+
+//-----------------------------------------------------------------------------
+//
+//    scmRTOS Context Switch Scheme
+//
+//    The host port switches directly from the scheduler.
+//
+#define  scmRTOS_CONTEXT_SWITCH_SCHEME 0
+
+//-----------------------------------------------------------------------------
+//
+//    The idle process waits for the next tick, or in virtual time mode runs
+//    it straight away.
+//
+#define scmRTOS_TARGET_IDLE_HOOK_ENABLE 1
+
+//-----------------------------------------------------------------------------
+//
+//     Include project-level configurations
+//    !!! The order of includes is important !!!
+//
+#include "scmRTOS_CONFIG.h"
+#include "scmRTOS_TARGET_CFG.h"
+
+// Tickless idle is implemented by the Cortex-M3 port only; the host idle
+// process already sleeps until the next tick.
+#undef  scmRTOS_TICKLESS_IDLE_ENABLE
+#define scmRTOS_TICKLESS_IDLE_ENABLE 0
+
+// Nor is there an interrupt mask to time.
+#undef  scmRTOS_CRITSECT_USER_HOOK_ENABLE
+#define scmRTOS_CRITSECT_USER_HOOK_ENABLE 0
+
+#include <scmRTOS_defs.h>
+
+//-----------------------------------------------------------------------------
+//
+//    Target-specific configuration macros
+//
+#ifdef scmRTOS_USER_DEFINED_STACK_PATTERN
+#define scmRTOS_STACK_PATTERN scmRTOS_USER_DEFINED_STACK_PATTERN
+#else
+#define scmRTOS_STACK_PATTERN 0xABBA
+#endif
+
+//-----------------------------------------------------------------------------
+//
+//     The Critical Section Wrapper
+//
+//     Processes all run on the host's main thread, and the system tick is a
+//     signal. Rather than mask the signal (a system call per critical
+//     section), critical sections count their nesting; a tick arriving inside
+//     one is left pending and run when the outermost section ends. The count
+//     is saved and restored per process by the context switcher, just as the
+//     interrupt mask would be.
+//
+namespace OS
+{
+    extern volatile int          PosixCritNest;
+    extern volatile sig_atomic_t PosixTickPending;
+
+    void posix_run_pending_tick();
+}
+
+class TCritSect
+{
+public:
+    TCritSect () { OS::PosixCritNest++; }
+    ~TCritSect()
+    {
+        if((--OS::PosixCritNest == 0) && OS::PosixTickPending)
+            OS::posix_run_pending_tick();
+    }
+};
+
+//-----------------------------------------------------------------------------
+//
+//     Priority stuff
+//
+//
+namespace OS
+{
+INLINE OS::TProcessMap get_prio_tag(const uint_fast8_t pr) { return static_cast<OS::TProcessMap> (1 << pr); }
+
+#if scmRTOS_PRIORITY_ORDER == 0
+    INLINE uint_fast8_t highest_priority(TProcessMap pm)
+    {
+        return __builtin_ctz(pm);
+    }
+#else
+    INLINE uint_fast8_t highest_priority(TProcessMap pm)
+    {
+        return 31 - __builtin_clz(pm);
+    }
+#endif // scmRTOS_PRIORITY_ORDER
+}
+
+namespace OS
+{
+    INLINE void enable_context_switch()  { }
+    INLINE void disable_context_switch() { }
+}
+
+#include <OS_Kernel.h>
+
+namespace OS
+{
+#if scmRTOS_ISRW_USER_HOOK_ENABLE == 1
+    INLINE uint_fast8_t get_active_exception() { return 0; }
+
+    void isrw_enter_user_hook(uint_fast8_t exception);
+    void isrw_exit_user_hook(uint_fast8_t exception);
+#endif // scmRTOS_ISRW_USER_HOOK_ENABLE
+
+    //--------------------------------------------------------------------------
+    //
+    //      NAME       :   OS ISR support
+    //
+    //      PURPOSE    :   Implements common actions on interrupt enter and exit
+    //                     under the OS
+    //
+    class TISRW
+    {
+    public:
+        INLINE  TISRW()  { ISR_Enter(); }
+        INLINE  ~TISRW() { ISR_Exit();  }
+
+    private:
+        //-----------------------------------------------------
+        INLINE void ISR_Enter()
+        {
+            TCritSect cs;
+            Kernel.ISR_NestCount++;
+        #if scmRTOS_ISRW_USER_HOOK_ENABLE == 1
+            isrw_enter_user_hook(get_active_exception());
+        #endif
+        }
+        //-----------------------------------------------------
+        INLINE void ISR_Exit()
+        {
+            TCritSect cs;
+        #if scmRTOS_ISRW_USER_HOOK_ENABLE == 1
+            isrw_exit_user_hook(get_active_exception());
+        #endif
+            if(--Kernel.ISR_NestCount) return;
+            Kernel.sched_isr();
+        }
+        //-----------------------------------------------------
+    };
+
+    #define TISRW_SS    TISRW
+
+} // ns OS
+//-----------------------------------------------------------------------------
+
+#endif // scmRTOS_POSIX_H
+//-----------------------------------------------------------------------------
@@ -0,0 +1,221 @@
+//******************************************************************************
+//*
+//*     FULLNAME:  Single-Chip Microcontroller Real-Time Operating System
+//*
+//*     NICKNAME:  scmRTOS
+//*
+//*     PROCESSOR: POSIX host
+//*
+//*     TOOLKIT:   GCC / Clang
+//*
+//*     PURPOSE:   Target Dependent Stuff Source
+//*
+//*     Version: 4.00
+//*
+//*     Copyright (c) 2003-2012, Harry E. Zhurov
+//*
+//*     Permission is hereby granted, free of charge, to any person
+//*     obtaining  a copy of this software and associated documentation
+//*     files (the "Software"), to deal in the Software without restriction,
+//*     including without limitation the rights to use, copy, modify, merge,
+//*     publish, distribute, sublicense, and/or sell copies of the Software,
+//*     and to permit persons to whom the Software is furnished to do so,
+//*     subject to the following conditions:
+//*
+//*     The above copyright notice and this permission notice shall be included
+//*     in all copies or substantial portions of the Software.
+//*
+//*     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//*     EXPRESS  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//*     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//*     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//*     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//*     TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+//*     THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//*
+//*     =================================================================
+//*     See http://scmrtos.sourceforge.net for documentation, latest
+//*     information, license and contact details.
+//*     =================================================================
+//*
+//******************************************************************************
+//*     POSIX host port for EBLmon host tools
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <scmRTOS.h>
+
+using namespace OS;
+
+//------------------------------------------------------------------------------
+//
+//    Each process runs on its own host stack, since the process stack pools
+//    sized for the target are far too small for libc and signal frames. The
+//    process StackPointer points at the process context rather than into
+//    its pool, so stack_slack() reports the untouched pool on the host.
+//
+#ifndef scmRTOS_POSIX_STACK_SIZE
+#define scmRTOS_POSIX_STACK_SIZE (64 * 1024)
+#endif
+
+struct TPosixContext
+{
+    ucontext_t  Context;
+    int         CritNest;
+};
+
+volatile int            OS::PosixCritNest;
+volatile sig_atomic_t   OS::PosixTickPending;
+TPosixTickMode          OS::PosixTickMode = ptmRealTime;
+
+// makecontext() passes int arguments only, so the entry point is split in two.
+// The halves are joined and split as 64-bit values; uintptr_t may be 32 bits,
+// and shifting it by 32 would be undefined.
+static_assert(sizeof(uintptr_t) <= sizeof(uint64_t), "entry point does not fit in two halves");
+
+static void process_entry(unsigned hi, unsigned lo)
+{
+    void (*exec)() = reinterpret_cast<void (*)()>(uintptr_t((uint64_t(hi) << 32) | lo));
+
+    // Fresh processes start outside any critical section.
+    PosixCritNest = 0;
+    exec();
+}
+
+void TBaseProcess::init_stack_frame( stack_item_t * Stack
+                                   , void (*exec)()
+                                #if scmRTOS_DEBUG_ENABLE == 1
+                                   , stack_item_t * StackBegin
+                                #endif
+                                   )
+{
+    TPosixContext *ctx = static_cast<TPosixContext *>(calloc(1, sizeof(TPosixContext)));
+    void *stack = malloc(scmRTOS_POSIX_STACK_SIZE);
+
+    if(!ctx || !stack)
+    {
+        fprintf(stderr, "scmRTOS: out of memory for process stacks\n");
+        abort();
+    }
+
+#if scmRTOS_DEBUG_ENABLE == 1
+    for (stack_item_t* pDst = StackBegin; pDst < Stack; pDst++)
+        *pDst = STACK_DEFAULT_PATTERN;
+#endif // scmRTOS_DEBUG_ENABLE
+
+    uintptr_t entry = reinterpret_cast<uintptr_t>(exec);
+
+    getcontext(&ctx->Context);
+    ctx->Context.uc_stack.ss_sp   = stack;
+    ctx->Context.uc_stack.ss_size = scmRTOS_POSIX_STACK_SIZE;
+    ctx->Context.uc_link          = 0;
+    makecontext(&ctx->Context, reinterpret_cast<void (*)()>(process_entry), 2,
+                unsigned(uint64_t(entry) >> 32), unsigned(entry));
+
+    StackPointer = reinterpret_cast<stack_item_t *>(ctx);
+}
+
+//------------------------------------------------------------------------------
+OS_INTERRUPT void OS::sys_tick_handler()
+{
+    scmRTOS_ISRW_TYPE ISR;
+
+    posix_tick_user_hook();
+
+    Kernel.system_timer();
+
+#if scmRTOS_SYSTIMER_HOOK_ENABLE == 1
+    system_timer_user_hook();
+#endif
+}
+
+//------------------------------------------------------------------------------
+//
+//    A tick that arrived inside a critical section. The signal is masked
+//    while it runs, as it would be in its own handler.
+//
+void OS::posix_run_pending_tick()
+{
+    sigset_t alarm, saved;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    sigprocmask(SIG_BLOCK, &alarm, &saved);
+
+    PosixTickPending = 0;
+    sys_tick_handler();
+
+    sigprocmask(SIG_SETMASK, &saved, 0);
+}
+
+static void tick_signal(int)
+{
+    if(PosixCritNest)
+    {
+        PosixTickPending = 1;
+        return;
+    }
+    sys_tick_handler();
+}
+
+//------------------------------------------------------------------------------
+//
+//    In virtual time the idle process stands in for the tick interrupt;
+//    otherwise it sleeps until the next signal.
+//
+void OS::idle_process_target_hook()
+{
+    if(PosixTickMode == ptmVirtual)
+    {
+        sys_tick_handler();
+    }
+    else
+    {
+        sigset_t none;
+        sigemptyset(&none);
+        sigsuspend(&none);
+    }
+}
+
+//------------------------------------------------------------------------------
+extern "C" void os_start(stack_item_t *sp)
+{
+    if(PosixTickMode == ptmRealTime)
+    {
+        struct sigaction sa = {};
+        sa.sa_handler = tick_signal;
+        sa.sa_flags   = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGALRM, &sa, 0);
+
+        struct itimerval period = {};
+        period.it_interval.tv_usec = 1000000 / SYSTICKINTRATE;
+        period.it_value            = period.it_interval;
+        setitimer(ITIMER_REAL, &period, 0);
+    }
+
+    setcontext(&reinterpret_cast<TPosixContext *>(sp)->Context);
+    fprintf(stderr, "scmRTOS: failed to start the first process\n");
+    abort();
+}
+
+//------------------------------------------------------------------------------
+//
+//    Called from the scheduler inside a critical section. The critical
+//    section nesting belongs to the process, so it is saved here and put
+//    back when this process is switched in again; it stays non-zero while
+//    the switch is in progress.
+//
+extern "C" void os_context_switcher(stack_item_t **Curr_SP, stack_item_t *Next_SP)
+{
+    TPosixContext *curr = reinterpret_cast<TPosixContext *>(*Curr_SP);
+    TPosixContext *next = reinterpret_cast<TPosixContext *>(Next_SP);
+
+    curr->CritNest = PosixCritNest;
+    swapcontext(&curr->Context, &next->Context);
+    PosixCritNest = curr->CritNest;
+}
+//------------------------------------------------------------------------------
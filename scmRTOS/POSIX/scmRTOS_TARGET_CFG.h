@@ -0,0 +1,88 @@
+//******************************************************************************
+//*
+//*     FULLNAME:  Single-Chip Microcontroller Real-Time Operating System
+//*
+//*     NICKNAME:  scmRTOS
+//*
+//*     PROCESSOR: POSIX host
+//*
+//*     TOOLKIT:   GCC / Clang
+//*
+//*     PURPOSE:   Project Level Configuration
+//*
+//*     Version: 4.00
+//*
+//*     Copyright (c) 2003-2012, Harry E. Zhurov
+//*
+//*     Permission is hereby granted, free of charge, to any person
+//*     obtaining  a copy of this software and associated documentation
+//*     files (the "Software"), to deal in the Software without restriction,
+//*     including without limitation the rights to use, copy, modify, merge,
+//*     publish, distribute, sublicense, and/or sell copies of the Software,
+//*     and to permit persons to whom the Software is furnished to do so,
+//*     subject to the following conditions:
+//*
+//*     The above copyright notice and this permission notice shall be included
+//*     in all copies or substantial portions of the Software.
+//*
+//*     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//*     EXPRESS  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//*     MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//*     IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//*     CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//*     TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+//*     THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//*
+//*     =================================================================
+//*     See http://scmrtos.sourceforge.net for documentation, latest
+//*     information, license and contact details.
+//*     =================================================================
+//*
+//******************************************************************************
+//*     POSIX host port for EBLmon host tools
+
+#ifndef  scmRTOS_TARGET_CFG_H
+#define  scmRTOS_TARGET_CFG_H
+
+// Tick rate matches the target so that timeouts mean the same thing.
+#define SYSTICKINTRATE  1000
+
+#ifndef __ASSEMBLER__
+//------------------------------------------------------------------------------
+//
+//       System Timer stuff
+//
+//       In real time mode the tick is driven by a 1ms interval timer
+//       (SIGALRM). In virtual time mode the idle process runs the next tick
+//       as soon as every other process is blocked, so time only passes when
+//       there is nothing else to do and code runs in zero simulated time;
+//       replayed input is processed as fast as the host allows.
+//
+//       Host tools that never start the scheduler may also advance time by
+//       calling sys_tick_handler() themselves.
+//
+namespace OS
+{
+OS_INTERRUPT void sys_tick_handler();
+
+// Called on every tick, in interrupt context, before the system timer runs.
+// The host board uses it to feed emulated peripherals.
+void posix_tick_user_hook();
+
+enum TPosixTickMode
+{
+    ptmRealTime,
+    ptmVirtual
+};
+
+// Must be set before OS::run().
+extern TPosixTickMode PosixTickMode;
+}
+
+#define  LOCK_SYSTEM_TIMER()
+#define  UNLOCK_SYSTEM_TIMER()
+
+#endif // __ASSEMBLER__
+
+#endif // scmRTOS_TARGET_CFG_H
+//-----------------------------------------------------------------------------
@@ -84,8 +84,9 @@ typedef uint_fast32_t tick_count_t;
 //
 //    scmRTOS System Timer Hook
 //
+//    Drives the software timers (src/timer.cpp).
 //
-#define  scmRTOS_SYSTIMER_HOOK_ENABLE       0
+#define  scmRTOS_SYSTIMER_HOOK_ENABLE       1
 
 //-----------------------------------------------------------------------------
 //
@@ -101,6 +102,17 @@ typedef uint_fast32_t tick_count_t;
 //
 #define scmRTOS_IDLE_PROCESS_STACK_SIZE       (100 * sizeof(stack_item_t))
 
+//-----------------------------------------------------------------------------
+//
+//    scmRTOS Tickless Idle enable
+//
+//    The macro enables/disables stopping the system tick while only the
+//    idle process is ready. The idle process sleeps until the nearest
+//    process timeout or an interrupt, then accounts for the skipped ticks.
+//    Cortex-M3 port only.
+//
+#define  scmRTOS_TICKLESS_IDLE_ENABLE       1
+
 //-----------------------------------------------------------------------------
 //
 //    scmRTOS Priority Order
@@ -125,7 +137,32 @@ typedef uint_fast32_t tick_count_t;
 //    Context Switch Hook function.
 //
 //
-#define  scmRTOS_CONTEXT_SWITCH_USER_HOOK_ENABLE  0
+#define  scmRTOS_CONTEXT_SWITCH_USER_HOOK_ENABLE  1
+
+//-----------------------------------------------------------------------------
+//
+//    scmRTOS ISR Wrapper User Hooks enable
+//
+//    The macro enables/disables user defined hooks called on entry to and
+//    exit from interrupt handlers that use the OS ISR wrapper. The hooks
+//    are passed the active exception number (0 on the POSIX port).
+//
+//
+#define  scmRTOS_ISRW_USER_HOOK_ENABLE  1
+
+//-----------------------------------------------------------------------------
+//
+//    scmRTOS Critical Section User Hooks enable
+//
+//    The macro enables/disables user defined hooks called when the
+//    outermost critical section masks interrupts and just before it
+//    unmasks them, for measuring how long interrupts stay masked. Cortex-M3
+//    port only; off unless the firmware is built with IRQ_STATS=1.
+//
+//
+#ifndef scmRTOS_CRITSECT_USER_HOOK_ENABLE
+#define  scmRTOS_CRITSECT_USER_HOOK_ENABLE  0
+#endif
 
 //-----------------------------------------------------------------------------
 //
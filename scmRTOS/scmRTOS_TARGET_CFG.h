@@ -61,6 +61,11 @@
 #define CPU_ICSR            ( ( volatile uint32_t *) 0xE000ED04 )   // Interrupt Control State Register
 #define CPU_SYSTICKCSR      ( ( volatile uint32_t *) 0xE000E010 )   // SysTick Control and Status Register
 #define CPU_SYSTICKCSR_EINT 0x02                                    // Bit for enable/disable SysTick interrupt
+#define CPU_SYSTICKCSR_EN   0x01                                    // Bit for enable/disable SysTick counter
+#define CPU_SYSTICKCSR_CNTF 0x00010000                              // Counter reached zero since last read
+#define CPU_SYSTICKRVR      ( ( volatile uint32_t *) 0xE000E014 )   // SysTick Reload Value Register
+#define CPU_SYSTICKCVR      ( ( volatile uint32_t *) 0xE000E018 )   // SysTick Current Value Register
+#define CPU_ICSR_PENDSTSET  0x04000000                              // SysTick exception pending
 
 #ifndef __ASSEMBLER__
 //------------------------------------------------------------------------------
@@ -37,30 +37,36 @@
 #include <stdio.h>
 #include <scmRTOS.h>
 
-#define debug(fmt, args...)	do { printf(fmt "\r\n", ##args); } while(0)
+#include "log.h"
 
 #define __noreturn	__attribute__((noreturn))
+#ifndef __unused
+#define __unused	__attribute__((unused))
+#endif
 
 namespace UI
 {
 extern void init();
 extern void tick();
+extern void wait();     // until there is something for tick() to do
 }
 
 namespace EBL
 {
+struct Frame;
+
+extern void init();					// start decoding serial data
 extern void decode(uint8_t c);
-extern bool was_updated();
-extern unsigned engine_speed();		// rpm
-extern unsigned ground_speed();		// mph
-extern unsigned oil_pressure();		// psi
-extern unsigned water_temperature();	// degrees C
-extern unsigned voltage();		// decivolts
-extern unsigned afr();			// afr * 10
-extern bool ses_set();
-extern bool engine_running();
+extern unsigned engine_speed(const Frame &frame);	// rpm
+extern unsigned ground_speed(const Frame &frame);	// mph
+extern unsigned oil_pressure(const Frame &frame);	// psi
+extern unsigned water_temperature(const Frame &frame);	// degrees C
+extern unsigned voltage(const Frame &frame);		// decivolts
+extern unsigned afr(const Frame &frame);		// afr * 10
+extern bool ses_set(const Frame &frame);
+extern bool engine_running(const Frame &frame);
 extern const char *status();
-extern const char *dtc_string(uint8_t index);
+extern const char *dtc_string(const Frame &frame, uint8_t index);
 
 extern volatile unsigned rx_count;
 extern volatile unsigned good_packets;
@@ -33,6 +33,9 @@
  */
 
 #include "board.h"
+#include "deferred.h"
+
+#include <string.h>
 
 /****************************************************************************
  * Serial port
@@ -40,19 +43,18 @@
 
 void Board::com_init(unsigned speed __unused) {}
 
-uint8_t
-Board::com_getc(void)
+unsigned
+Board::com_read(uint8_t *data, unsigned len)
 {
     TCritSect cs;
+    unsigned count = 0;
 
-    while (_rx_tail == _rx_head) {
-        _rx_data_avail.wait();
+    while ((count < len) && (_rx_tail != _rx_head)) {
+        data[count++] = _rx_buf[_rx_head];
+        _rx_head = (_rx_head + 1) % _rx_buf_size;
     }
 
-    auto c = _rx_buf[_rx_head];
-    _rx_head = (_rx_head + 1) % _rx_buf_size;
-
-    return c;
+    return count;
 }
 
 void
@@ -68,13 +70,124 @@ Board::com_rx(uint8_t c)
     _rx_buf[_rx_tail] = c;
     _rx_tail = next;
 
-    // wake anyone that might be waiting
-    _rx_data_avail.signal_isr();
+    if (auto work = _rx_notify) {
+        _rx_notify = nullptr;
+        work->post_isr();
+    }
+}
+
+void Board::com_tx_start() {}
+
+unsigned
+Board::com_write(const void *data, unsigned len)
+{
+    static_assert((_tx_buf_size & (_tx_buf_size - 1)) == 0, "_tx_buf_size must be a power of 2");
+
+    auto src = static_cast<const uint8_t *>(data);
+    unsigned queued = 0;
+
+    TCritSect cs;
+
+    while (queued < len) {
+        auto space = _tx_buf_size - (_tx_tail - _tx_head);
+
+        if (space == 0) {
+            if (com_tx_policy == COM_TX_DROP) {
+                com_tx_dropped += len - queued;
+                break;
+            }
+
+            com_tx_waits++;
+            _tx_space.clear();
+            com_tx_start();
+            _tx_space.wait();
+            continue;
+        }
+
+        // copy up to the space available or the end of the buffer
+        auto offset = _tx_tail & (_tx_buf_size - 1);
+        auto count = len - queued;
+
+        if (count > space) {
+            count = space;
+        }
+
+        if (count > (_tx_buf_size - offset)) {
+            count = _tx_buf_size - offset;
+        }
+
+        memcpy(&_tx_buf[offset], src + queued, count);
+        _tx_tail += count;
+        queued += count;
+    }
+
+    com_tx_bytes += queued;
+    com_tx_start();
+
+    return queued;
+}
+
+bool
+Board::com_write_frame(const void *data, unsigned len)
+{
+    TCritSect cs;
+
+    if ((com_tx_policy == COM_TX_DROP) && ((_tx_buf_size - (_tx_tail - _tx_head)) < len)) {
+        com_tx_dropped += len;
+        return false;
+    }
+
+    return com_write(data, len) == len;
+}
+
+const uint8_t *
+Board::com_tx_peek(unsigned &len)
+{
+    auto pending = _tx_tail - _tx_head;
+
+    if (pending == 0) {
+        return nullptr;
+    }
+
+    auto offset = _tx_head & (_tx_buf_size - 1);
+
+    len = (pending < (_tx_buf_size - offset)) ? pending : (_tx_buf_size - offset);
+    return &_tx_buf[offset];
+}
+
+void
+Board::com_tx_done(unsigned len)
+{
+    _tx_head += len;
+
+    // wake a writer waiting for room
+    _tx_space.signal_isr();
 }
 
+/****************************************************************************
+ * Storage
+ */
+
+uint32_t Board::storage_init() { return 0; }
+bool Board::storage_busy() { return false; }
+void Board::storage_erase(uint32_t address __unused) {}
+void Board::storage_program(uint32_t address __unused, const void *data __unused, unsigned len __unused) {}
+void Board::storage_read(uint32_t address __unused, void *data, unsigned len) { memset(data, 0xff, len); }
+
+const uint16_t *Board::settings_page(unsigned page __unused) { return nullptr; }
+void Board::settings_erase(unsigned page __unused) {}
+void Board::settings_program(unsigned page __unused, unsigned offset __unused, uint16_t value __unused) {}
+
 void Board::led_set(bool state __unused) {}
 void Board::led_toggle() {}
 
+/****************************************************************************
+ * Timing
+ */
+
+uint32_t Board::cycle_count() { return 0; }
+unsigned Board::cycles_per_us() { return 1; }
+
 /****************************************************************************
  * u8g graphics library support
  */
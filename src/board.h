@@ -40,6 +40,8 @@
 
 #include "EBLmon.h"
 
+class DeferredWork;
+
 class Board;
 extern Board *gBoard;
 
@@ -75,11 +77,156 @@ public:
     /**
      * Read data from the serial port.
      *
-     * This function will block until data is available.
+     * Never waits; returns what has been received, up to len bytes.
+     *
+     * @param data              Buffer for the data.
+     * @param len               Size of the buffer.
+     * @return                  Bytes read, 0 if none are waiting.
+     */
+    unsigned                    com_read(uint8_t *data, unsigned len);
+
+    /**
+     * Check for received data.
+     *
+     * @return                  True if com_read() would return data.
+     */
+    bool                        com_rx_pending() const { return _rx_tail != _rx_head; }
+
+    /**
+     * Post work when data next arrives.
+     *
+     * The work is posted once, from the receive interrupt, for the first
+     * byte received after the call; call again to re-arm.
+     *
+     * @param work              Posted with no argument.
+     */
+    void                        com_rx_notify(DeferredWork *work) { _rx_notify = work; }
+
+    enum ComTxPolicy : uint8_t {
+        COM_TX_DROP,            ///< discard what doesn't fit
+        COM_TX_BLOCK            ///< wait for room; processes only
+    };
+
+    /**
+     * Queue data for transmission on the serial port.
+     *
+     * The data is copied into the transmit ring and sent in the
+     * background by the board driver. What happens when the ring is
+     * full depends on com_tx_policy.
+     *
+     * @param data              The data to send.
+     * @param len               Bytes to send.
+     * @return                  Bytes queued; less than len only if some
+     *                          were dropped.
+     */
+    unsigned                    com_write(const void *data, unsigned len);
+
+    /**
+     * Queue a framed message for transmission.
+     *
+     * As com_write(), except that with COM_TX_DROP a message that does
+     * not fit is dropped whole, so the receiver never sees part of one.
+     *
+     * @param data              The message.
+     * @param len               Bytes in the message.
+     * @return                  True if the message was queued.
+     */
+    bool                        com_write_frame(const void *data, unsigned len);
+
+    /**
+     * Room in the transmit ring.
+     *
+     * @return                  Bytes that com_write() would queue now.
+     */
+    unsigned                    com_tx_space() const { return _tx_buf_size - (_tx_tail - _tx_head); }
+
+    /** what com_write() does when the transmit ring is full */
+    ComTxPolicy                 com_tx_policy = COM_TX_DROP;
+
+    /** bytes queued, bytes dropped, and times a writer waited for room */
+    unsigned                    com_tx_bytes = 0;
+    unsigned                    com_tx_dropped = 0;
+    unsigned                    com_tx_waits = 0;
+
+    /*
+     * Block storage for the flight recorder: SPI NOR flash on hardware,
+     * a file on the host. Addresses are in bytes. Erasing sets a sector
+     * to 0xff; programming can only clear bits.
+     */
+    static const unsigned       storage_page_size = 256;        ///< most one program can write
+    static const unsigned       storage_sector_size = 4096;     ///< erase unit
+
+    /**
+     * Probe for the storage device.
+     *
+     * @return                  The device size in bytes, or 0 if there is
+     *                          no storage.
+     */
+    virtual uint32_t            storage_init();
+
+    /**
+     * Check whether an erase or program is still in progress.
+     */
+    virtual bool                storage_busy();
+
+    /**
+     * Start erasing a sector.
+     *
+     * @param address           Address of the sector.
+     */
+    virtual void                storage_erase(uint32_t address);
+
+    /**
+     * Start programming data.
      *
-     * @return                  Data read from the port.
+     * @param address           Where to program.
+     * @param data              The data.
+     * @param len               Bytes to program; must not cross a page
+     *                          boundary.
      */
-    uint8_t                     com_getc(void);
+    virtual void                storage_program(uint32_t address, const void *data, unsigned len);
+
+    /**
+     * Read data, waiting for an erase or program to finish first.
+     *
+     * @param address           Where to read from.
+     * @param data              Buffer for the data.
+     * @param len               Bytes to read.
+     */
+    virtual void                storage_read(uint32_t address, void *data, unsigned len);
+
+    /*
+     * Settings storage: two pages of the MCU's own flash on hardware, RAM
+     * or a file on the host. Pages are read in place. Erasing sets a page
+     * to 0xffff words; each word can be programmed once after that. Both
+     * wait until done, and on hardware stall the CPU meanwhile.
+     */
+    static const unsigned       settings_page_size = 1024;      ///< bytes
+
+    /**
+     * Fetch a settings page.
+     *
+     * @param page              The page, 0 or 1.
+     * @return                  The page contents, or nullptr if there is
+     *                          no settings storage.
+     */
+    virtual const uint16_t      *settings_page(unsigned page);
+
+    /**
+     * Erase a settings page.
+     *
+     * @param page              The page, 0 or 1.
+     */
+    virtual void                settings_erase(unsigned page);
+
+    /**
+     * Program a word of a settings page.
+     *
+     * @param page              The page, 0 or 1.
+     * @param offset            Byte offset of the word in the page.
+     * @param value             The value to program.
+     */
+    virtual void                settings_program(unsigned page, unsigned offset, uint16_t value);
 
     /**
      * Turn the LED on or off.
@@ -98,8 +245,28 @@ public:
      */
     u8g_dev_t                   *u8g_dev() { return _u8g_dev; }
 
+    /**
+     * Read the free-running CPU cycle counter.
+     *
+     * @return                  The current cycle count, wraps at 2^32.
+     */
+    virtual uint32_t            cycle_count();
+
+    /**
+     * Rate at which the cycle counter advances.
+     *
+     * @return                  Cycles per microsecond.
+     */
+    virtual unsigned            cycles_per_us();
+
     unsigned                    com_interrupts = 0;
 
+    /** display pages the driver sends on the next frame, others are left alone */
+    uint8_t                     display_page_mask = 0xff;
+
+    /** the display is still set up from before a reset; set before UI::init() to skip its reset, self test and clear */
+    bool                        display_warm_start = false;
+
 protected:
     /** graphics driver */
     u8g_dev_t                   *_u8g_dev;
@@ -112,10 +279,44 @@ protected:
      */
     void                        com_rx(uint8_t c);
 
+    /**
+     * Start sending from the transmit ring if the transmitter is idle.
+     *
+     * Called with interrupts disabled when data has been queued.
+     */
+    virtual void                com_tx_start();
+
+    /**
+     * Next contiguous run of bytes waiting to be sent.
+     *
+     * The bytes stay in the ring until released by com_tx_done(), so
+     * they can be handed to DMA in place.
+     *
+     * @param len               Set to the length of the run.
+     * @return                  The first byte, or nullptr if the ring
+     *                          is empty.
+     */
+    const uint8_t               *com_tx_peek(unsigned &len);
+
+    /**
+     * Release bytes that have been sent.
+     *
+     * Called from the transmit interrupt.
+     *
+     * @param len               Bytes sent.
+     */
+    void                        com_tx_done(unsigned len);
+
 private:
     static const unsigned       _rx_buf_size = 1024;
-    OS::TEventFlag              _rx_data_avail;
     uint8_t                     _rx_buf[_rx_buf_size + 1];
     unsigned                    _rx_head = 0;
     unsigned                    _rx_tail = 0;
+    DeferredWork                *volatile _rx_notify = nullptr;
+
+    static const unsigned       _tx_buf_size = 1024;    // must be a power of 2
+    OS::TEventFlag              _tx_space;
+    uint8_t                     _tx_buf[_tx_buf_size];
+    unsigned                    _tx_head = 0;           ///< next byte to send, free-running
+    unsigned                    _tx_tail = 0;           ///< next byte to fill, free-running
 };
@@ -36,16 +36,26 @@ extern "C" {
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/usart.h>
+#include <libopencm3/stm32/dma.h>
 #include <libopencm3/stm32/spi.h>
+#include <libopencm3/stm32/flash.h>
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/dwt.h>
 }
 
 #include <stdio.h>
 #include <errno.h>
 
 #include "board.h"
+#include "latency.h"
+
+#ifndef DISPLAY_SELF_TEST
+# define DISPLAY_SELF_TEST      0       // all-pixels on/off at power on, 200ms
+#endif
 
 extern "C" void usart1_isr(void);
+extern "C" uint16_t _settings_flash[];      /* from the linker script */
+extern "C" void dma1_channel4_isr(void);
 
 class Board_FLD_V2 : public Board
 {
@@ -55,14 +65,42 @@ public:
     virtual void        com_init(unsigned speed) override;
     virtual void        led_set(bool state) override;
     virtual void        led_toggle() override;
+    virtual uint32_t    cycle_count() override;
+    virtual unsigned    cycles_per_us() override;
+
+    virtual uint32_t    storage_init() override;
+    virtual bool        storage_busy() override;
+    virtual void        storage_erase(uint32_t address) override;
+    virtual void        storage_program(uint32_t address, const void *data, unsigned len) override;
+    virtual void        storage_read(uint32_t address, void *data, unsigned len) override;
+
+    virtual const uint16_t *settings_page(unsigned page) override;
+    virtual void        settings_erase(unsigned page) override;
+    virtual void        settings_program(unsigned page, unsigned offset, uint16_t value) override;
 
     static uint8_t      u8g_com_hw_spi_fn(u8g_t *u8g, uint8_t msg, uint8_t arg_val, void *arg_ptr);
     static uint8_t      u8g_board_dev_fn(u8g_t *u8g, u8g_dev_t *dev, uint8_t msg, void *arg);
 
 protected:
+    virtual void        com_tx_start() override;
 
 private:
     friend void         usart1_isr(void);
+    friend void         dma1_channel4_isr(void);
+
+    bool                _tx_ready = false;      ///< USART configured
+    unsigned            _tx_dma_len = 0;        ///< bytes in the running DMA transfer, 0 if idle
+
+    OS::TMutex          _spi_lock;              ///< SPI1 is shared by the display and flash
+    bool                _display_selected = false;
+
+    void                flash_select();
+    void                flash_deselect();
+    void                flash_command(uint8_t command, uint32_t address);
+    void                flash_write_enable();
+
+    void                spi_dma(const uint8_t *data, unsigned len, bool increment);
+    void                spi_clock(uint32_t setup);
 };
 
 static Board_FLD_V2 board_fld_v2;
@@ -88,6 +126,7 @@ Board_FLD_V2::Board_FLD_V2() :
                                 RCC_APB2ENR_SPI1EN |
                                 RCC_APB2ENR_AFIOEN |
                                 RCC_APB2ENR_USART1EN);
+    rcc_peripheral_enable_clock(&RCC_AHBENR, RCC_AHBENR_DMA1EN);
 
     /* configure LED GPIO */
     gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, GPIO11);
@@ -122,6 +161,9 @@ Board_FLD_V2::Board_FLD_V2() :
     gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, GPIO2); /* /RST */
     gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, GPIO3); /* A0 */
     gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, GPIO4); /* CS */
+
+    /* start the cycle counter for performance measurements */
+    dwt_enable_cycle_counter();
 }
 
 void
@@ -141,6 +183,18 @@ Board_FLD_V2::led_set(bool state)
     }
 }
 
+uint32_t
+Board_FLD_V2::cycle_count()
+{
+    return DWT_CYCCNT;
+}
+
+unsigned
+Board_FLD_V2::cycles_per_us()
+{
+    return 72;
+}
+
 void
 Board_FLD_V2::com_init(unsigned speed)
 {
@@ -152,33 +206,280 @@ Board_FLD_V2::com_init(unsigned speed)
     usart_set_flow_control(USART1, USART_FLOWCONTROL_NONE);
     usart_set_mode(USART1, USART_MODE_TX_RX);
 
+    /* 10 bits per character */
+    Latency::set_char_time(cycles_per_us() * 10000000U / speed);
+
     /* enable receive interrupt */
     usart_enable_rx_interrupt(USART1);
     nvic_enable_irq(NVIC_USART1_IRQ);
 
+    /* transmit from the ring by DMA (USART1_TX is DMA1 channel 4) */
+    dma_channel_reset(DMA1, DMA_CHANNEL4);
+    dma_set_peripheral_address(DMA1, DMA_CHANNEL4, (uint32_t)&USART_DR(USART1));
+    dma_set_read_from_memory(DMA1, DMA_CHANNEL4);
+    dma_enable_memory_increment_mode(DMA1, DMA_CHANNEL4);
+    dma_set_peripheral_size(DMA1, DMA_CHANNEL4, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, DMA_CHANNEL4, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, DMA_CHANNEL4, DMA_CCR_PL_LOW);
+    dma_enable_transfer_complete_interrupt(DMA1, DMA_CHANNEL4);
+    nvic_enable_irq(NVIC_DMA1_CHANNEL4_IRQ);
+    usart_enable_tx_dma(USART1);
+
     /* and enable the UART */
     usart_enable(USART1);
+
+    /* send anything logged before now */
+    TCritSect cs;
+    _tx_ready = true;
+    com_tx_start();
+}
+
+/*
+ * Flight recorder storage.
+ *
+ * A 25-series SPI NOR flash fitted to the expansion pins shares SPI1
+ * with the display: /CS is PB13 (a spare pin) and DO goes to PA6, the
+ * SPI1 MISO pin. The display holds the bus lock while it is selected.
+ *
+ * The display driver configures SPI1, which it does before the timer
+ * process that runs the recorder gets to run.
+ *
+ * The display runs in SPI mode 2 at FPCLK/2 (36MHz). 25-series flash
+ * only supports modes 0 and 3, and 36MHz is beyond what some parts
+ * allow for the 0x03 READ command, so SPI1 is switched to mode 3 at
+ * FPCLK/4 (18MHz) while the flash is selected. Both modes idle with SCK
+ * high, so the switch puts no edge on the clock line.
+ */
+static const uint32_t spi_clock_display = SPI_CR1_BAUDRATE_FPCLK_DIV_2 |
+                                          SPI_CR1_CPOL_CLK_TO_1_WHEN_IDLE |
+                                          SPI_CR1_CPHA_CLK_TRANSITION_1;
+static const uint32_t spi_clock_flash = SPI_CR1_BAUDRATE_FPCLK_DIV_4 |
+                                        SPI_CR1_CPOL_CLK_TO_1_WHEN_IDLE |
+                                        SPI_CR1_CPHA_CLK_TRANSITION_2;
+
+/**
+ * Change the SPI1 clock rate and mode; the bus must be idle.
+ */
+void
+Board_FLD_V2::spi_clock(uint32_t setup)
+{
+    /* DIV_256 sets all of the BR bits */
+    const uint32_t mask = SPI_CR1_BAUDRATE_FPCLK_DIV_256 | SPI_CR1_CPOL | SPI_CR1_CPHA;
+
+    spi_disable(SPI1);
+    SPI_CR1(SPI1) = (SPI_CR1(SPI1) & ~mask) | setup;
+    spi_enable(SPI1);
+}
+
+void
+Board_FLD_V2::flash_select()
+{
+    _spi_lock.lock();
+    spi_clock(spi_clock_flash);
+    gpio_clear(GPIOB, GPIO13);
+}
+
+void
+Board_FLD_V2::flash_deselect()
+{
+    while (SPI_SR(SPI1) & SPI_SR_BSY) {
+    }
+
+    gpio_set(GPIOB, GPIO13);
+    spi_clock(spi_clock_display);
+    _spi_lock.unlock();
+}
+
+void
+Board_FLD_V2::flash_command(uint8_t command, uint32_t address)
+{
+    spi_xfer(SPI1, command);
+    spi_xfer(SPI1, address >> 16);
+    spi_xfer(SPI1, address >> 8);
+    spi_xfer(SPI1, address);
+}
+
+void
+Board_FLD_V2::flash_write_enable()
+{
+    flash_select();
+    spi_xfer(SPI1, 0x06);               /* WREN */
+    flash_deselect();
+}
+
+uint32_t
+Board_FLD_V2::storage_init()
+{
+    gpio_set(GPIOB, GPIO13);
+    gpio_set_mode(GPIOB, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, GPIO13);
+
+    /* pulled up, so that with no flash fitted the ID reads as 0xff */
+    gpio_set_mode(GPIOA, GPIO_MODE_INPUT, GPIO_CNF_INPUT_PULL_UPDOWN, GPIO6);
+    gpio_set(GPIOA, GPIO6);
+
+    flash_select();
+    spi_xfer(SPI1, 0x9f);               /* JEDEC ID */
+    uint8_t manufacturer = spi_xfer(SPI1, 0);
+    spi_xfer(SPI1, 0);                  /* memory type */
+    uint8_t capacity = spi_xfer(SPI1, 0);
+    flash_deselect();
+
+    /* 3-byte addressing reaches 16MiB */
+    if ((manufacturer == 0x00) || (manufacturer == 0xff) ||
+        (capacity < 0x10) || (capacity > 0x18)) {
+        return 0;
+    }
+
+    return 1UL << capacity;
+}
+
+bool
+Board_FLD_V2::storage_busy()
+{
+    flash_select();
+    spi_xfer(SPI1, 0x05);               /* RDSR */
+    uint8_t status = spi_xfer(SPI1, 0);
+    flash_deselect();
+
+    return status & 0x01;               /* WIP */
+}
+
+void
+Board_FLD_V2::storage_erase(uint32_t address)
+{
+    flash_write_enable();
+    flash_select();
+    flash_command(0x20, address);       /* 4K sector erase */
+    flash_deselect();
+}
+
+void
+Board_FLD_V2::storage_program(uint32_t address, const void *data, unsigned len)
+{
+    auto p = static_cast<const uint8_t *>(data);
+
+    flash_write_enable();
+    flash_select();
+    flash_command(0x02, address);       /* page program */
+
+    while (len--) {
+        spi_xfer(SPI1, *p++);
+    }
+
+    flash_deselect();
+}
+
+void
+Board_FLD_V2::storage_read(uint32_t address, void *data, unsigned len)
+{
+    auto p = static_cast<uint8_t *>(data);
+
+    while (storage_busy()) {
+    }
+
+    flash_select();
+    flash_command(0x03, address);       /* read */
+
+    while (len--) {
+        *p++ = spi_xfer(SPI1, 0);
+    }
+
+    flash_deselect();
+}
+
+/*
+ * Settings storage.
+ *
+ * The top two pages of the internal flash, kept out of the image by the
+ * linker script. Code runs from the same flash, so the CPU stalls for as
+ * long as each erase or program takes.
+ */
+static_assert(Board::settings_page_size == FLASH_PAGE_SIZE, "settings pages must be flash pages");
+
+const uint16_t *
+Board_FLD_V2::settings_page(unsigned page)
+{
+    return &_settings_flash[page * settings_page_size / 2];
+}
+
+void
+Board_FLD_V2::settings_erase(unsigned page)
+{
+    flash_unlock();
+    flash_erase_page((uint32_t)settings_page(page));
+    flash_lock();
+}
+
+void
+Board_FLD_V2::settings_program(unsigned page, unsigned offset, uint16_t value)
+{
+    flash_unlock();
+    flash_program_half_word((uint32_t)settings_page(page) + offset, value);
+    flash_lock();
+}
+
+/*
+ * Called with interrupts disabled, from com_write() or the DMA interrupt.
+ */
+void
+Board_FLD_V2::com_tx_start()
+{
+    if (!_tx_ready || (_tx_dma_len != 0)) {
+        return;
+    }
+
+    unsigned len;
+    auto data = com_tx_peek(len);
+
+    if (data == nullptr) {
+        return;
+    }
+
+    dma_disable_channel(DMA1, DMA_CHANNEL4);
+    dma_set_memory_address(DMA1, DMA_CHANNEL4, (uint32_t)data);
+    dma_set_number_of_data(DMA1, DMA_CHANNEL4, len);
+    dma_enable_channel(DMA1, DMA_CHANNEL4);
+    _tx_dma_len = len;
 }
 
 OS_INTERRUPT void
 usart1_isr(void)
 {
+    uint32_t entry = DWT_CYCCNT;
+
     OS::scmRTOS_ISRW_TYPE ISR;
 
     gBoard->com_interrupts++;
 
     /* receiver not empty? */
-    if (usart_get_flag(USART1, USART_SR_RXNE))
+    if (usart_get_flag(USART1, USART_SR_RXNE)) {
+        Latency::serial_rx_entry(entry, usart_get_flag(USART1, USART_SR_ORE));
         board_fld_v2.com_rx(usart_recv(USART1));
+    }
+}
 
+OS_INTERRUPT void
+dma1_channel4_isr(void)
+{
+    OS::scmRTOS_ISRW_TYPE ISR;
+
+    if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL4, DMA_TCIF)) {
+        dma_clear_interrupt_flags(DMA1, DMA_CHANNEL4, DMA_TCIF);
+
+        board_fld_v2.com_tx_done(board_fld_v2._tx_dma_len);
+        board_fld_v2._tx_dma_len = 0;
+        board_fld_v2.com_tx_start();
+    }
 }
 
+/*
+ * Console output goes through the transmit ring; report everything as
+ * written even if some was dropped, or newlib would retry the rest.
+ */
 extern "C" int
 _write(int file __unused, char *ptr, int len)
 {
-    for (auto i = 0; i < len; i++) {
-        usart_send_blocking(USART1, *ptr++);
-    }
+    gBoard->com_write(ptr, len);
 
     return len;
 }
@@ -187,6 +488,49 @@ _write(int file __unused, char *ptr, int len)
  * u8g interface driver
  */
 
+/*
+ * Send a run of bytes to the selected SPI device by DMA (SPI1_TX is DMA1
+ * channel 3), waiting until the last has gone. Without increment the
+ * same byte is sent len times. What comes back is thrown away.
+ */
+void
+Board_FLD_V2::spi_dma(const uint8_t *data, unsigned len, bool increment)
+{
+    if (len == 0) {
+        return;
+    }
+
+    dma_channel_reset(DMA1, DMA_CHANNEL3);
+    dma_set_peripheral_address(DMA1, DMA_CHANNEL3, (uint32_t)&SPI_DR(SPI1));
+    dma_set_memory_address(DMA1, DMA_CHANNEL3, (uint32_t)data);
+    dma_set_number_of_data(DMA1, DMA_CHANNEL3, len);
+    dma_set_read_from_memory(DMA1, DMA_CHANNEL3);
+
+    if (increment) {
+        dma_enable_memory_increment_mode(DMA1, DMA_CHANNEL3);
+    }
+
+    dma_set_peripheral_size(DMA1, DMA_CHANNEL3, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, DMA_CHANNEL3, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, DMA_CHANNEL3, DMA_CCR_PL_HIGH);
+    dma_enable_channel(DMA1, DMA_CHANNEL3);
+    spi_enable_tx_dma(SPI1);
+
+    /* a page is 128 bytes, under 30us at 36MHz; not worth sleeping for */
+    while (!dma_get_interrupt_flag(DMA1, DMA_CHANNEL3, DMA_TCIF)) {
+    }
+
+    while (!(SPI_SR(SPI1) & SPI_SR_TXE) || (SPI_SR(SPI1) & SPI_SR_BSY)) {
+    }
+
+    spi_disable_tx_dma(SPI1);
+    dma_disable_channel(DMA1, DMA_CHANNEL3);
+
+    /* drop the last byte received and the overrun it caused */
+    (void)SPI_DR(SPI1);
+    (void)SPI_SR(SPI1);
+}
+
 static const uint8_t u8g_dev_init_seq[] = {
     U8G_ESC_CS(0),      /* de-select display */
     U8G_ESC_ADR(0),     /* instruction mode */
@@ -205,10 +549,33 @@ static const uint8_t u8g_dev_init_seq[] = {
     0x23,               /* Rab Ratio  */
     0x81, 0x25,         /* E-Vol setting */
 
+#if DISPLAY_SELF_TEST
     U8G_ESC_DLY(100),   /* delay 100 ms */
     0xa5,               /* all-pixels-on */
     U8G_ESC_DLY(100),   /* delay 100 ms */
     0xa4,               /* all-pixels-off */
+#endif
+    U8G_ESC_CS(0),      /* disable chip */
+    U8G_ESC_END         /* end of sequence */
+};
+
+/* as above, without the reset, self test or delays */
+static const uint8_t u8g_dev_warm_init_seq[] = {
+    U8G_ESC_CS(0),      /* de-select display */
+    U8G_ESC_ADR(0),     /* instruction mode */
+    U8G_ESC_CS(1),      /* select display */
+
+    0xaf,               /* display on */
+    0x40,               /* display start line = 0 */
+    0xc8,               /* COM scan direction (reverse) */
+    0xa6,               /* normal display */
+    0xa0,               /* scan in normal direction */
+    0xa4,               /* clear display */
+    0xa2,               /* LCD bias = 1/9 */
+    0x2f,               /* Power control = all on */
+    0x23,               /* Rab Ratio  */
+    0x81, 0x25,         /* E-Vol setting */
+
     U8G_ESC_CS(0),      /* disable chip */
     U8G_ESC_END         /* end of sequence */
 };
@@ -225,15 +592,16 @@ uint8_t
 Board_FLD_V2::u8g_com_hw_spi_fn(u8g_t *u8g __unused, uint8_t msg, uint8_t arg_val, void *arg_ptr)
 {
     switch (msg) {
-    case U8G_COM_MSG_INIT:
+    case U8G_COM_MSG_INIT: {
         //debug("u8com: init");
 
         /* configure SPI */
+        OS::TMutexLocker lock(board_fld_v2._spi_lock);
         spi_init_master(
             SPI1,
             SPI_CR1_BAUDRATE_FPCLK_DIV_2,
             SPI_CR1_CPOL_CLK_TO_1_WHEN_IDLE,
-            SPI_CR1_CPHA_CLK_TRANSITION_1,
+            SPI_CR1_CPHA_CLK_TRANSITION_1,      /* as spi_clock_display */
             SPI_CR1_DFF_8BIT,
             SPI_CR1_MSBFIRST);
 
@@ -241,8 +609,8 @@ Board_FLD_V2::u8g_com_hw_spi_fn(u8g_t *u8g __unused, uint8_t msg, uint8_t arg_va
         spi_enable_ss_output(SPI1);
         spi_set_nss_high(SPI1);
         spi_enable(SPI1);
-
-        break;
+    }
+    break;
 
     case U8G_COM_MSG_STOP:
         spi_disable(SPI1);
@@ -262,12 +630,22 @@ Board_FLD_V2::u8g_com_hw_spi_fn(u8g_t *u8g __unused, uint8_t msg, uint8_t arg_va
 
     case U8G_COM_MSG_CHIP_SELECT:
         if (arg_val) {
-            /* select display */
+            /* select display, taking the bus from the flash */
+            if (!board_fld_v2._display_selected) {
+                board_fld_v2._spi_lock.lock();
+                board_fld_v2._display_selected = true;
+            }
+
             gpio_clear(GPIOA, GPIO4);
 
         } else {
             /* deselect display */
             gpio_set(GPIOA, GPIO4);
+
+            if (board_fld_v2._display_selected) {
+                board_fld_v2._display_selected = false;
+                board_fld_v2._spi_lock.unlock();
+            }
         }
 
         break;
@@ -290,11 +668,7 @@ Board_FLD_V2::u8g_com_hw_spi_fn(u8g_t *u8g __unused, uint8_t msg, uint8_t arg_va
 
     case U8G_COM_MSG_WRITE_SEQ:
     case U8G_COM_MSG_WRITE_SEQ_P:
-        for (auto ptr = (uint8_t *)arg_ptr; arg_val > 0; arg_val--) {
-            spi_xfer(SPI1, *ptr++);
-        }
-
-        /* XXX wait for the last byte to finish transferring... */
+        board_fld_v2.spi_dma((const uint8_t *)arg_ptr, arg_val, true);
         break;
     }
 
@@ -308,6 +682,13 @@ Board_FLD_V2::u8g_board_dev_fn(u8g_t *u8g, u8g_dev_t *dev, uint8_t msg, void *ar
     case U8G_DEV_MSG_INIT:
         //debug("u8dev: init");
         u8g_InitCom(u8g, dev, U8G_SPI_CLK_CYCLE_50NS);
+
+        /* after a warm reset the panel still holds the last picture, and the first frame redraws it all */
+        if (board_fld_v2.display_warm_start) {
+            u8g_WriteEscSeqP(u8g, dev, u8g_dev_warm_init_seq);
+            break;
+        }
+
         u8g_WriteEscSeqP(u8g, dev, u8g_dev_init_seq);
 
         for (unsigned page = 0; page < (HEIGHT / PAGE_HEIGHT); page++) {
@@ -315,8 +696,8 @@ Board_FLD_V2::u8g_board_dev_fn(u8g_t *u8g, u8g_dev_t *dev, uint8_t msg, void *ar
             u8g_WriteByte(u8g, dev, 0xb0 | page);
             u8g_SetAddress(u8g, dev, 1);
 
-            for (unsigned column = 0; column < WIDTH; column++)
-                u8g_WriteByte(u8g, dev, 0);
+            static const uint8_t zero = 0;
+            board_fld_v2.spi_dma(&zero, WIDTH, false);
 
             u8g_SetChipSelect(u8g, dev, 0);
         }
@@ -329,6 +710,10 @@ Board_FLD_V2::u8g_board_dev_fn(u8g_t *u8g, u8g_dev_t *dev, uint8_t msg, void *ar
     case U8G_DEV_MSG_PAGE_NEXT: {
         u8g_pb_t *pb = (u8g_pb_t *)(dev->dev_mem);
 
+        /* leave clean pages alone */
+        if (!(board_fld_v2.display_page_mask & (1 << pb->p.page)))
+            break;
+
         u8g_WriteEscSeqP(u8g, dev, u8g_dev_data_start);
         u8g_WriteByte(u8g, dev, 0xb0 | pb->p.page);
         u8g_SetAddress(u8g, dev, 1);
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file boot.cpp
+ *
+ * Boot phase timing.
+ */
+
+#include "EBLmon.h"
+#include "board.h"
+#include "boot.h"
+#include "retained.h"
+
+namespace Boot
+{
+
+namespace
+{
+
+uint32_t stamps[NUM_BOOT_PHASES];               // cycles, 0 until reached
+bool reported;                                  // up to the gauges
+bool frame_reported;
+
+const char *const phase_names[] = {
+    "main",
+    "os",
+    "display",
+    "gauges",
+    "first frame",
+};
+static_assert((sizeof(phase_names) / sizeof(phase_names[0])) == NUM_BOOT_PHASES,
+              "phase_names out of step with Phase");
+
+void
+print(unsigned phase)
+{
+    auto us = stamps[phase] / gBoard->cycles_per_us();
+
+    debug("boot: %s at %lu.%03lu ms", phase_names[phase],
+          (unsigned long)(us / 1000), (unsigned long)(us % 1000));
+}
+
+} // namespace
+
+void
+mark(Phase phase)
+{
+    if (stamps[phase] == 0) {
+        // 0 means not reached
+        stamps[phase] = gBoard->cycle_count() | 1;
+    }
+}
+
+void
+report()
+{
+    if (frame_reported || (stamps[BOOT_GAUGES] == 0)) {
+        return;
+    }
+
+    if (!reported) {
+        debug("boot: %s", Retained::warm ? "warm" : "cold");
+
+        for (unsigned phase = 0; phase < BOOT_FIRST_FRAME; phase++) {
+            if (stamps[phase] != 0) {
+                print(phase);
+            }
+        }
+
+        reported = true;
+    }
+
+    if (stamps[BOOT_FIRST_FRAME] != 0) {
+        print(BOOT_FIRST_FRAME);
+        frame_reported = true;
+    }
+}
+
+} // namespace Boot
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file boot.h
+ *
+ * Boot phase timing.
+ *
+ * Each phase is stamped with the cycle counter the first time it is
+ * reached. The counter starts as the board is set up, straight after
+ * the clocks, so the times are close to time since reset. The report
+ * is printed once the gauges are up, with the first frame following
+ * if it has not arrived by then.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace Boot
+{
+
+enum Phase : uint8_t {
+    BOOT_MAIN,                  ///< static constructors done, main() entered
+    BOOT_OS,                    ///< processes about to start
+    BOOT_DISPLAY,               ///< display set up
+    BOOT_GAUGES,                ///< first gauge screen drawn
+    BOOT_FIRST_FRAME,           ///< first decoded frame reached the display
+    NUM_BOOT_PHASES
+};
+
+/**
+ * Note that a phase has been reached; later calls are ignored.
+ */
+extern void mark(Phase phase);
+
+/**
+ * Print the boot times, once they are known.
+ *
+ * Call periodically; prints nothing after the first frame is reported.
+ */
+extern void report();
+
+} // namespace Boot
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file capture.cpp
+ *
+ * Fault capture.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "board.h"
+#include "capture.h"
+#include "cobs.h"
+#include "crc.h"
+#include "frame.h"
+#include "task.h"
+
+namespace Capture
+{
+
+unsigned captures;
+unsigned missed;
+
+namespace
+{
+
+static_assert(offsetof(EBL::Frame, adc) + sizeof(EBL::Frame::adc) == frame_data_size,
+              "frame data must be contiguous");
+static_assert(CAPTURE_POST_FRAMES < CAPTURE_FRAMES, "post-trigger window too long");
+
+struct Slot {
+    uint32_t                    timestamp;
+    uint32_t                    sequence;
+    uint8_t                     data[frame_data_size];
+};
+
+enum State : uint8_t {
+    ARMED,                      ///< keeping the last frames
+    TRIGGERED,                  ///< adding the post-trigger window
+    FROZEN                      ///< being sent
+};
+
+const unsigned message_size = 14 + frame_data_size + 2;
+
+class Sender : public Task
+{
+public:
+    Sender() : Task("capture") {}
+
+protected:
+    Action                      run() override;
+
+private:
+    unsigned                    _index;
+
+    bool                        send();
+};
+
+Sender sender;
+
+Slot slots[CAPTURE_FRAMES];
+volatile State state = ARMED;
+unsigned next;                                  // slot to fill next
+unsigned filled;                                // slots holding frames
+unsigned post_frames = CAPTURE_POST_FRAMES;
+unsigned post_window;                           // post-trigger frames in this capture
+unsigned post_remaining;
+unsigned trigger_index;                         // of the triggering frame, oldest first
+uint8_t triggers;
+
+// trigger state as of the previous frame
+bool have_previous;
+bool ses_was_set;
+bool oil_was_low;
+bool cts_was_high;
+uint8_t dtc_was[3];                             // DTC bitmaps at 0x12-0x14
+
+// one message at a time, encoded as it is built
+uint8_t message[COBS::max_encoded(message_size) + 2];
+
+uint8_t
+check_triggers(const EBL::Frame &frame)
+{
+    bool ses = EBL::ses_set(frame);
+    bool oil_low = EBL::engine_running(frame) && (EBL::oil_pressure(frame) < CAPTURE_OIL_PSI);
+    bool cts_high = EBL::water_temperature(frame) > CAPTURE_CTS_C;
+    uint8_t fired = 0;
+
+    // the first frame sets the baseline
+    if (have_previous) {
+        if (ses && !ses_was_set) {
+            fired |= TRIG_SES;
+        }
+
+        for (unsigned i = 0; i < sizeof(dtc_was); i++) {
+            if (frame.mem[0x12 + i] & ~dtc_was[i]) {
+                fired |= TRIG_DTC;
+            }
+        }
+
+        if (oil_low && !oil_was_low) {
+            fired |= TRIG_OIL_LOW;
+        }
+
+        if (cts_high && !cts_was_high) {
+            fired |= TRIG_CTS_HIGH;
+        }
+    }
+
+    have_previous = true;
+    ses_was_set = ses;
+    oil_was_low = oil_low;
+    cts_was_high = cts_high;
+    memcpy(dtc_was, &frame.mem[0x12], sizeof(dtc_was));
+
+    return fired;
+}
+
+/*
+ * Queue frame _index of the capture; false if the transmit ring is full.
+ */
+bool
+Sender::send()
+{
+    auto &slot = slots[(next + CAPTURE_FRAMES - filled + _index) % CAPTURE_FRAMES];
+    const uint8_t header[] = {
+        Log::LOG_FRAME_CAPTURE,
+        (uint8_t)captures,
+        (uint8_t)_index,
+        (uint8_t)filled,
+        (uint8_t)trigger_index,
+        triggers,
+        (uint8_t)slot.timestamp, (uint8_t)(slot.timestamp >> 8),
+        (uint8_t)(slot.timestamp >> 16), (uint8_t)(slot.timestamp >> 24),
+        (uint8_t)slot.sequence, (uint8_t)(slot.sequence >> 8),
+        (uint8_t)(slot.sequence >> 16), (uint8_t)(slot.sequence >> 24),
+    };
+    static_assert(sizeof(header) + frame_data_size + 2 == message_size, "message layout");
+
+    auto crc = CRC::crc16(slot.data, frame_data_size, CRC::crc16(header, sizeof(header)));
+    COBS::Encoder e(&message[1]);
+
+    e.put(header, sizeof(header));
+    e.put(slot.data, frame_data_size);
+    e.put(crc & 0xff);
+    e.put(crc >> 8);
+
+    auto len = e.finish() + 1;
+    message[0] = 0;
+    message[len++] = 0;
+
+    return gBoard->com_write_frame(message, len);
+}
+
+Task::Action
+Sender::run()
+{
+    TASK_BEGIN();
+
+    for (;;) {
+        TASK_WAIT_UNTIL(state == FROZEN);
+
+        debug("capture %u: triggers %x, %u frames", captures, triggers, filled);
+
+        for (_index = 0; _index < filled; _index++) {
+            // the transmit ring holds a few frames at most; wait for it to drain
+            while (!send()) {
+                TASK_SLEEP(TASK_POLL_TICKS);
+            }
+
+            TASK_YIELD();
+        }
+
+        // start again with an empty ring
+        {
+            TCritSect cs;
+
+            captures++;
+            next = 0;
+            filled = 0;
+            triggers = 0;
+            state = ARMED;
+        }
+    }
+
+    TASK_END();
+}
+
+} // namespace
+
+void
+init()
+{
+    sender.start();
+}
+
+void
+frame(const EBL::Frame &frame)
+{
+    auto fired = check_triggers(frame);
+
+    switch (state) {
+    case ARMED:
+    case TRIGGERED: {
+        auto &slot = slots[next];
+
+        slot.timestamp = OS::get_tick_count();
+        slot.sequence = frame.sequence;
+        memcpy(slot.data, frame.mem, frame_data_size);
+        next = (next + 1) % CAPTURE_FRAMES;
+
+        if (filled < CAPTURE_FRAMES) {
+            filled++;
+        }
+    }
+    break;
+
+    case FROZEN:
+        if (fired) {
+            missed++;
+        }
+
+        return;
+    }
+
+    if ((state == ARMED) && fired) {
+        triggers = fired;
+        post_window = post_frames;
+        post_remaining = post_window;
+        state = TRIGGERED;
+
+    } else if (state == TRIGGERED) {
+        triggers |= fired;
+        post_remaining--;
+    }
+
+    if ((state == TRIGGERED) && (post_remaining == 0)) {
+        trigger_index = filled - 1 - post_window;
+        state = FROZEN;
+        sender.wake();
+    }
+}
+
+void
+set_post_frames(unsigned frames)
+{
+    post_frames = (frames < CAPTURE_FRAMES) ? frames : (CAPTURE_FRAMES - 1);
+}
+
+} // namespace Capture
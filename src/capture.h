@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file capture.h
+ *
+ * Fault capture.
+ *
+ * The last CAPTURE_FRAMES decoded frames are kept in a ring in RAM.
+ * When a trigger fires, a post-trigger window of frames is added and the
+ * ring is then frozen and sent on the console; recording starts again
+ * once it has been sent. Triggers that fire while a capture is being
+ * taken or sent are added to it, or counted as missed.
+ *
+ * Triggers, checked on each frame against the one before:
+ *
+ *   TRIG_SES                   the SES light comes on
+ *   TRIG_DTC                   a new trouble code is set
+ *   TRIG_OIL_LOW               oil pressure falls below CAPTURE_OIL_PSI
+ *                              with the engine running
+ *   TRIG_CTS_HIGH              coolant temperature rises above
+ *                              CAPTURE_CTS_C
+ *
+ * Each frame of a capture is sent as a COBS-encoded frame between 0x00
+ * delimiters (as telemetry.h), with the payload:
+ *
+ *   LOG_FRAME_CAPTURE
+ *   capture                    8 bits, counts captures
+ *   index                      8 bits, of the frame, oldest first
+ *   count                      8 bits, frames in the capture
+ *   trigger                    8 bits, index of the frame that triggered
+ *   triggers                   8 bits, TRIG_ flags
+ *   timestamp                  32 bits, ticks since boot
+ *   sequence                   32 bits, EBL good packet count
+ *   mem, adc                   the frame's ECU RAM image and ADC readings
+ *   CRC                        16 bits, CRC::crc16 of the above
+ *
+ * with multi-byte values little-endian.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "EBLmon.h"
+
+#ifndef CAPTURE_FRAMES
+# define CAPTURE_FRAMES         10      // frames per capture, 280 bytes of RAM each
+#endif
+#ifndef CAPTURE_POST_FRAMES
+# define CAPTURE_POST_FRAMES    3       // default frames after the trigger
+#endif
+#ifndef CAPTURE_OIL_PSI
+# define CAPTURE_OIL_PSI        10
+#endif
+#ifndef CAPTURE_CTS_C
+# define CAPTURE_CTS_C          110
+#endif
+
+namespace Capture
+{
+
+enum Trigger : uint8_t {
+    TRIG_SES            = 0x01,
+    TRIG_DTC            = 0x02,
+    TRIG_OIL_LOW        = 0x04,
+    TRIG_CTS_HIGH       = 0x08,
+};
+
+/** bytes of frame data in each capture frame */
+const unsigned frame_data_size = 256 + 16;
+
+/**
+ * Start the task that sends captures.
+ */
+extern void init();
+
+/**
+ * Add a frame to the ring and check the triggers.
+ *
+ * Called by the decoder for each good packet; a fixed amount of work.
+ *
+ * @param frame                 The decoded frame.
+ */
+extern void frame(const EBL::Frame &frame);
+
+/**
+ * Set the post-trigger window.
+ *
+ * @param frames                Frames to keep after the trigger; at most
+ *                              CAPTURE_FRAMES - 1.
+ */
+extern void set_post_frames(unsigned frames);
+
+/** captures sent, and triggers that fired while busy */
+extern unsigned captures;
+extern unsigned missed;
+
+} // namespace Capture
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file cobs.h
+ *
+ * Consistent Overhead Byte Stuffing.
+ *
+ * Encoded data contains no zero bytes, so frames sent on the serial port
+ * are delimited with a single 0x00 and a receiver can pick up at the next
+ * frame after any loss. Encoding adds one byte per 254 bytes of data.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace COBS
+{
+
+/**
+ * Worst-case encoded size.
+ */
+constexpr unsigned
+max_encoded(unsigned len)
+{
+    return len + len / 254 + 1;
+}
+
+/**
+ * Encoder for data that is produced a byte at a time.
+ */
+class Encoder
+{
+public:
+    /**
+     * @param out               Output, at least max_encoded() of the
+     *                          data length.
+     */
+    Encoder(uint8_t *out) : _out(out) {}
+
+    void                        put(uint8_t c)
+    {
+        if (c != 0) {
+            _out[_pos++] = c;
+            _code++;
+        }
+
+        // a zero, or a full run, closes the current block
+        if ((c == 0) || (_code == 0xff)) {
+            _out[_code_pos] = _code;
+            _code_pos = _pos++;
+            _code = 1;
+        }
+    }
+
+    void                        put(const void *data, unsigned len)
+    {
+        auto p = static_cast<const uint8_t *>(data);
+
+        while (len--) {
+            put(*p++);
+        }
+    }
+
+    /**
+     * Close the last block; the terminating 0x00 is not added.
+     *
+     * @return                  Bytes written to the output.
+     */
+    unsigned                    finish()
+    {
+        _out[_code_pos] = _code;
+        return _pos;
+    }
+
+private:
+    uint8_t                     *_out;
+    unsigned                    _code_pos = 0;
+    unsigned                    _pos = 1;
+    uint8_t                     _code = 1;
+};
+
+/**
+ * Encode a buffer.
+ *
+ * @param in                    The data.
+ * @param len                   Bytes of data.
+ * @param out                   Output, at least max_encoded(len) bytes;
+ *                              the terminating 0x00 is not added.
+ * @return                      Bytes written to out.
+ */
+static inline unsigned
+encode(const uint8_t *in, unsigned len, uint8_t *out)
+{
+    Encoder e(out);
+
+    e.put(in, len);
+    return e.finish();
+}
+
+/**
+ * Decode a frame.
+ *
+ * @param in                    The encoded frame, without the 0x00.
+ * @param len                   Bytes in the frame.
+ * @param out                   Output.
+ * @param out_size              Size of the output; a frame that decodes
+ *                              to more is rejected.
+ * @return                      Bytes decoded, or -1 if the frame is
+ *                              malformed or too large.
+ */
+static inline int
+decode(const uint8_t *in, unsigned len, uint8_t *out, unsigned out_size)
+{
+    unsigned pos = 0;
+    unsigned n = 0;
+
+    while (pos < len) {
+        uint8_t code = in[pos++];
+
+        if ((code == 0) || ((pos + code - 1) > len)) {
+            return -1;
+        }
+
+        if ((n + code - 1) > out_size) {
+            return -1;
+        }
+
+        for (unsigned i = 1; i < code; i++) {
+            out[n++] = in[pos++];
+        }
+
+        // a short block stands for a zero, except at the end of the frame
+        if ((code < 0xff) && (pos < len)) {
+            if (n >= out_size) {
+                return -1;
+            }
+
+            out[n++] = 0;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Splits a stream into frames and decodes them.
+ *
+ * A stream picked up mid-frame loses only that frame. Frames that do
+ * not decode, or that decode to more than MAX_LEN bytes, are dropped and
+ * counted.
+ *
+ * @tparam MAX_LEN              Largest decoded frame accepted.
+ */
+template<unsigned MAX_LEN>
+class Reader
+{
+public:
+    /**
+     * Add a byte from the stream.
+     *
+     * @return                  Bytes in data() when c completes a good
+     *                          frame, otherwise 0.
+     */
+    unsigned                    put(uint8_t c)
+    {
+        if (c != 0) {
+            if (_len < sizeof(_in)) {
+                _in[_len] = c;
+            }
+
+            // one past the buffer marks the frame as too long
+            if (_len <= sizeof(_in)) {
+                _len++;
+            }
+
+            return 0;
+        }
+
+        unsigned len = _len;
+        _len = 0;
+
+        // back-to-back delimiters are not a frame
+        if (len == 0) {
+            return 0;
+        }
+
+        int n = -1;
+
+        if (len <= sizeof(_in)) {
+            n = decode(_in, len, _out, sizeof(_out));
+        }
+
+        if (n < 1) {
+            _bad++;
+            return 0;
+        }
+
+        return n;
+    }
+
+    const uint8_t               *data() const { return _out; }
+    unsigned                    bad() const { return _bad; }
+
+private:
+    uint8_t                     _in[max_encoded(MAX_LEN)];
+    uint8_t                     _out[MAX_LEN];
+    unsigned                    _len = 0;
+    unsigned                    _bad = 0;
+};
+
+} // namespace COBS
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file crc.h
+ *
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xffff).
+ *
+ * A 16-entry table keeps the code small; data on this board is checked
+ * in frames of tens of bytes.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace CRC
+{
+
+/**
+ * Add data to a CRC.
+ *
+ * @param data                  The data.
+ * @param len                   Bytes of data.
+ * @param crc                   CRC so far; the default starts a new one.
+ * @return                      The updated CRC.
+ */
+static inline uint16_t
+crc16(const void *data, unsigned len, uint16_t crc = 0xffff)
+{
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+        0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    };
+    auto p = static_cast<const uint8_t *>(data);
+
+    while (len--) {
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (*p >> 4)];
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (*p++ & 0x0f)];
+    }
+
+    return crc;
+}
+
+} // namespace CRC
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file deferred.cpp
+ *
+ * Deferred work for interrupt handlers.
+ *
+ * The queue is a bounded ring in which each slot carries a sequence
+ * number. A producer claims a slot by advancing the head with a
+ * compare-and-swap, fills it, then publishes it by setting the slot's
+ * sequence; a producer interrupted part way through only holds up the
+ * slots behind its own, and the consumer picks them up when it is woken
+ * again. There is only one consumer, so the tail needs no atomics.
+ */
+
+#include "board.h"
+#include "deferred.h"
+
+static_assert((DEFERRED_ITEMS & (DEFERRED_ITEMS - 1)) == 0, "DEFERRED_ITEMS must be a power of 2");
+
+unsigned        DeferredWork::queue_high_water;
+DeferredWork    *DeferredWork::_list;
+OS::TEventFlag  DeferredWork::_event;
+
+namespace
+{
+struct Item {
+    uint32_t                    seq;            // == position when free, position + 1 when full
+    DeferredWork                *work;
+    void                        *arg;
+    uint32_t                    posted;         // cycle counter
+};
+
+struct Queue {
+    Item                        items[DEFERRED_ITEMS];
+    uint32_t                    head;           // next position to claim
+    uint32_t                    tail;           // next position to run
+
+    Queue()
+    {
+        for (unsigned i = 0; i < DEFERRED_ITEMS; i++) {
+            items[i].seq = i;
+        }
+    }
+};
+
+Queue queue;
+} // namespace
+
+DeferredWork::DeferredWork(const char *name, Handler handler) :
+    _name(name),
+    _handler(handler),
+    _next(_list)
+{
+    _list = this;
+}
+
+bool
+DeferredWork::enqueue(void *arg)
+{
+    auto pos = __atomic_load_n(&queue.head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        auto &item = queue.items[pos & (DEFERRED_ITEMS - 1)];
+        auto diff = (int32_t)(__atomic_load_n(&item.seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            // free; claim it, or retry from wherever the head has moved to
+            if (__atomic_compare_exchange_n(&queue.head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                item.work = this;
+                item.arg = arg;
+                item.posted = gBoard->cycle_count();
+                __atomic_store_n(&item.seq, pos + 1, __ATOMIC_RELEASE);
+                break;
+            }
+
+        } else if (diff < 0) {
+            // still holding an item from the last lap
+            __atomic_add_fetch(&_drops, 1, __ATOMIC_RELAXED);
+            return false;
+
+        } else {
+            pos = __atomic_load_n(&queue.head, __ATOMIC_RELAXED);
+        }
+    }
+
+    // approximate; the tail may already have moved past this item
+    auto depth = (int32_t)(pos + 1 - queue.tail);
+
+    if (depth > (int32_t)queue_high_water) {
+        queue_high_water = depth;
+    }
+
+    return true;
+}
+
+bool
+DeferredWork::post_isr(void *arg)
+{
+    if (!enqueue(arg)) {
+        return false;
+    }
+
+    _event.signal_isr();
+    return true;
+}
+
+bool
+DeferredWork::post(void *arg)
+{
+    if (!enqueue(arg)) {
+        return false;
+    }
+
+    _event.signal();
+    return true;
+}
+
+void
+DeferredWork::call(void *arg, uint32_t posted)
+{
+    auto start = gBoard->cycle_count();
+
+    _handler(arg);
+
+    auto latency = start - posted;
+    auto run_time = gBoard->cycle_count() - start;
+
+    _calls++;
+    _period_calls++;
+    _period_latency += latency;
+
+    if (latency > _latency_max) {
+        _latency_max = latency;
+    }
+
+    if (run_time > _run_max) {
+        _run_max = run_time;
+    }
+}
+
+void
+DeferredWork::run()
+{
+    for (;;) {
+        _event.wait();
+
+        // run everything published so far, including items posted by
+        // interrupts taken while the batch is running
+        for (;;) {
+            auto &item = queue.items[queue.tail & (DEFERRED_ITEMS - 1)];
+
+            if (__atomic_load_n(&item.seq, __ATOMIC_ACQUIRE) != (queue.tail + 1)) {
+                break;
+            }
+
+            auto work = item.work;
+            auto arg = item.arg;
+            auto posted = item.posted;
+
+            // hand the slot back before running, the handler may post more work
+            __atomic_store_n(&item.seq, queue.tail + DEFERRED_ITEMS, __ATOMIC_RELEASE);
+            queue.tail++;
+
+            work->call(arg, posted);
+        }
+    }
+}
+
+void
+DeferredWork::report()
+{
+    auto cpu = gBoard->cycles_per_us();
+
+    for (auto w = _list; w != nullptr; w = w->_next) {
+        unsigned calls, latency;
+
+        {
+            TCritSect cs;
+
+            calls = w->_period_calls;
+            latency = w->_period_latency;
+            w->_period_calls = 0;
+            w->_period_latency = 0;
+        }
+
+        debug("%u %s deferred %u dropped, latency avg %u max %u us, run max %u us",
+              w->_calls, w->_name, w->_drops,
+              calls ? (unsigned)(latency / calls / cpu) : 0,
+              (unsigned)(w->_latency_max / cpu), (unsigned)(w->_run_max / cpu));
+    }
+}
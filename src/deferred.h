@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file deferred.h
+ *
+ * Deferred work for interrupt handlers.
+ *
+ * Interrupt handlers post (work, argument) items to a lock-free queue and
+ * return; the deferred work process, which runs above every other
+ * process, wakes and drains the queue in batches, calling each item's
+ * handler in process context. Drivers get a cheap bottom half without
+ * needing a process and stack of their own.
+ *
+ * Each DeferredWork object is one type of item and keeps its own counts
+ * and post-to-run latency.
+ */
+
+#pragma once
+
+#include <scmRTOS.h>
+
+#ifndef DEFERRED_ITEMS
+# define DEFERRED_ITEMS         16      // must be a power of 2
+#endif
+
+class DeferredWork
+{
+public:
+    typedef void                (*Handler)(void *arg);
+
+    /**
+     * @param name              Short name for the report.
+     * @param handler           Called in the deferred work process for
+     *                          each item posted.
+     */
+    DeferredWork(const char *name, Handler handler);
+
+    /**
+     * Queue a call from an interrupt handler.
+     *
+     * The handler must be wrapped with TISRW so that the deferred work
+     * process is switched to on the way out.
+     *
+     * @param arg               Passed to the handler.
+     * @return                  False if the queue was full and the item
+     *                          was dropped.
+     */
+    bool                        post_isr(void *arg = nullptr);
+
+    /**
+     * Queue a call from a process.
+     */
+    bool                        post(void *arg = nullptr);
+
+    /**
+     * Run queued items; the body of the deferred work process.
+     */
+    static void                 run() __attribute__((noreturn));
+
+    /**
+     * Print per-type counts and latency, and start a new averaging period.
+     */
+    static void                 report();
+
+    /** most items waiting at once */
+    static unsigned             queue_high_water;
+
+private:
+    const char                  *const _name;
+    const Handler               _handler;
+    DeferredWork                *_next;                 ///< all work types, for the report
+    unsigned                    _calls = 0;
+    unsigned                    _drops = 0;
+    unsigned                    _period_calls = 0;      ///< calls since the last report
+    uint32_t                    _period_latency = 0;    ///< total latency since the last report, cycles
+    uint32_t                    _latency_max = 0;       ///< cycles
+    uint32_t                    _run_max = 0;           ///< cycles
+
+    bool                        enqueue(void *arg);
+    void                        call(void *arg, uint32_t posted);
+
+    static DeferredWork         *_list;
+    static OS::TEventFlag       _event;
+};
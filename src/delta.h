@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file delta.h
+ *
+ * Delta codec for EBL frames.
+ *
+ * Consecutive frames differ in a few dozen bytes at most. Each frame is
+ * XORed with the one before, and coded as a bitmap of the bytes that
+ * changed followed by the XOR of each changed byte. The bitmap is mostly
+ * zero, so runs of zero bitmap bytes are run-length coded.
+ *
+ *   key frame                  DELTA_KEY, block_size bytes of frame
+ *   delta frame                DELTA_DIFF, coded bitmap, changed bytes
+ *
+ * In the coded bitmap, a 0x00 is followed by the number of zero bitmap
+ * bytes it stands for (1-255); other bytes are literal. Bit n of bitmap
+ * byte m is frame byte 8m + n.
+ *
+ * A key frame is sent every keyframe_interval frames, so a reader can
+ * start part way through a log, and whenever a delta would be no smaller.
+ *
+ * Frames are compared a word at a time on the assumption of a
+ * little-endian CPU, as both the board and hosts are.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef DELTA_KEYFRAME
+# define DELTA_KEYFRAME         32      // frames between key frames
+#endif
+
+namespace Delta
+{
+
+/** bytes in a frame: the ECU RAM image and ADC readings */
+const unsigned block_size = 256 + 16;
+const unsigned bitmap_size = block_size / 8;
+
+/** largest coded frame */
+const unsigned max_encoded = 1 + block_size;
+
+/** longest coded bitmap; alternate changed and unchanged bitmap bytes */
+const unsigned max_coded_bitmap = bitmap_size + bitmap_size / 2;
+
+/** room the encoder needs to work in */
+const unsigned encode_buffer_size = 1 + max_coded_bitmap + block_size;
+
+enum FrameType : uint8_t {
+    DELTA_KEY           = 0x00,
+    DELTA_DIFF          = 0x01,
+};
+
+static_assert((block_size % 8) == 0, "block_size must be a multiple of 8");
+
+/**
+ * Bitmask of the non-zero bytes in a word, bit n for byte n.
+ */
+static inline unsigned
+nonzero_bytes(uint32_t x)
+{
+    x |= x >> 4;
+    x |= x >> 2;
+    x |= x >> 1;
+    x &= 0x01010101;
+    return (x * 0x01020408) >> 24;
+}
+
+class Encoder
+{
+public:
+    /**
+     * @param keyframe_interval Frames between key frames.
+     */
+    Encoder(unsigned keyframe_interval = DELTA_KEYFRAME) :
+        _interval(keyframe_interval),
+        _since_key(keyframe_interval)
+    {
+    }
+
+    /**
+     * Code a frame.
+     *
+     * @param block             The frame, block_size bytes.
+     * @param out               Output, at least encode_buffer_size bytes.
+     * @return                  Bytes of coded frame, at most max_encoded.
+     */
+    unsigned                    encode(const uint8_t *block, uint8_t *out)
+    {
+        if (_since_key >= _interval) {
+            return key(block, out);
+        }
+
+        // one pass builds the changed-byte bitmap and collects the changed
+        // bytes after the longest the coded bitmap can be, 8 bytes at a time
+        uint8_t bitmap[bitmap_size];
+        auto bytes = &out[1 + max_coded_bitmap];
+        auto q = bytes;
+
+        for (unsigned i = 0; i < bitmap_size; i++) {
+            uint32_t a[2], b[2];
+
+            memcpy(a, &block[i * 8], 8);
+            memcpy(b, &_prev[i * 8], 8);
+            a[0] ^= b[0];
+            a[1] ^= b[1];
+
+            if ((a[0] | a[1]) == 0) {
+                bitmap[i] = 0;
+                continue;
+            }
+
+            auto bits = nonzero_bytes(a[0]) | (nonzero_bytes(a[1]) << 4);
+            auto x = reinterpret_cast<const uint8_t *>(a);
+
+            bitmap[i] = bits;
+
+            for (; bits != 0; bits &= bits - 1) {
+                *q++ = x[__builtin_ctz(bits)];
+            }
+        }
+
+        // run-length code the bitmap
+        auto p = out;
+        *p++ = DELTA_DIFF;
+
+        for (unsigned i = 0; i < bitmap_size;) {
+            if (bitmap[i] != 0) {
+                *p++ = bitmap[i++];
+                continue;
+            }
+
+            unsigned run = 1;
+
+            while (((i + run) < bitmap_size) && (bitmap[i + run] == 0)) {
+                run++;
+            }
+
+            *p++ = 0;
+            *p++ = run;
+            i += run;
+        }
+
+        unsigned changed = q - bytes;
+
+        // not worth it
+        if (((p - out) + changed) >= max_encoded) {
+            return key(block, out);
+        }
+
+        memmove(p, bytes, changed);
+        memcpy(_prev, block, block_size);
+        p += changed;
+        _since_key++;
+        return p - out;
+    }
+
+    /**
+     * Make the next frame a key frame.
+     */
+    void                        reset() { _since_key = _interval; }
+
+private:
+    uint8_t                     _prev[block_size];
+    unsigned                    _interval;
+    unsigned                    _since_key;
+
+    unsigned                    key(const uint8_t *block, uint8_t *out)
+    {
+        out[0] = DELTA_KEY;
+        memcpy(&out[1], block, block_size);
+        memcpy(_prev, block, block_size);
+        _since_key = 1;
+        return 1 + block_size;
+    }
+};
+
+class Decoder
+{
+public:
+    /**
+     * Decode a frame.
+     *
+     * @param in                The coded frame.
+     * @param len               Bytes in the coded frame.
+     * @param block             Output, block_size bytes.
+     * @return                  False if the frame is malformed, or is a
+     *                          delta with no key frame before it.
+     */
+    bool                        decode(const uint8_t *in, unsigned len, uint8_t *block)
+    {
+        auto end = in + len;
+
+        if (len < 1) {
+            return false;
+        }
+
+        if (in[0] == DELTA_KEY) {
+            if (len != (1 + block_size)) {
+                return false;
+            }
+
+            memcpy(_prev, &in[1], block_size);
+            memcpy(block, _prev, block_size);
+            _have_key = true;
+            return true;
+        }
+
+        if ((in[0] != DELTA_DIFF) || !_have_key) {
+            return false;
+        }
+
+        // expand the bitmap
+        uint8_t bitmap[bitmap_size];
+        auto p = &in[1];
+
+        for (unsigned i = 0; i < bitmap_size;) {
+            if (p >= end) {
+                return false;
+            }
+
+            if (*p != 0) {
+                bitmap[i++] = *p++;
+                continue;
+            }
+
+            if (((p + 1) >= end) || (p[1] == 0) || ((i + p[1]) > bitmap_size)) {
+                return false;
+            }
+
+            memset(&bitmap[i], 0, p[1]);
+            i += p[1];
+            p += 2;
+        }
+
+        for (unsigned i = 0; i < bitmap_size; i++) {
+            for (unsigned bits = bitmap[i]; bits != 0; bits &= bits - 1) {
+                if (p >= end) {
+                    _have_key = false;
+                    return false;
+                }
+
+                _prev[i * 8 + __builtin_ctz(bits)] ^= *p++;
+            }
+        }
+
+        if (p != end) {
+            _have_key = false;
+            return false;
+        }
+
+        memcpy(block, _prev, block_size);
+        return true;
+    }
+
+    /**
+     * Discard the previous frame; deltas are refused until the next key
+     * frame. Call when frames have been lost.
+     */
+    void                        reset() { _have_key = false; }
+
+private:
+    uint8_t                     _prev[block_size];
+    bool                        _have_key = false;
+};
+
+} // namespace Delta
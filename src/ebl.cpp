@@ -34,17 +34,16 @@
 
 #include "EBLmon.h"
 #include "board.h"
-
-#include <math.h>
+#include "capture.h"
+#include "deferred.h"
+#include "ebl_packet.h"
+#include "frame.h"
+#include "task.h"
+#include "trace.h"
 
 namespace EBL
 {
 
-uint8_t     ebl_mem[256];
-uint16_t    ebl_adc[8];
-
-bool        updated = false;
-
 volatile unsigned rx_count = 0;
 volatile unsigned good_packets = 0;
 volatile unsigned bad_packets = 0;
@@ -63,26 +62,37 @@ void
 decode(uint8_t c)
 {
     static unsigned running_sum = 0U;
+    static uint8_t checksum_hi = 0U;
     static unsigned field_index = 0U;
     static DecodeState state = WAIT_H1;
+    static Frame *frame = nullptr;      // kept across bad packets
+
+    // every byte before the checksum counts towards it
+    if (state < WAIT_C1) {
+        running_sum = packet_sum(running_sum, c);
+    }
 
-    running_sum += c;
     rx_count++;
 
     switch (state) {
     case WAIT_H1:
-        if (c == 0x55) {
+        if (c == packet_h1) {
             state = WAIT_H2;
-            running_sum = c;
+            running_sum = packet_sum(0, c);
         }
 
         break;
 
     case WAIT_H2:
-        if (c == 0xaa) {
+        if (c == packet_h2) {
             state = ARRAY;
             field_index = 0;
 
+            // with no frame to decode into the packet is checked but lost
+            if (frame == nullptr) {
+                frame = frame_alloc();
+            }
+
         } else {
             state = WAIT_H1;
         }
@@ -90,9 +100,11 @@ decode(uint8_t c)
         break;
 
     case ARRAY:
-        ebl_mem[field_index] = c;
+        if (frame != nullptr) {
+            frame->mem[field_index] = c;
+        }
 
-        if (++field_index == 256) {
+        if (++field_index == packet_mem_size) {
             state = STATUS;
         }
 
@@ -104,39 +116,41 @@ decode(uint8_t c)
         break;
 
     case ADC:
-        if ((field_index & 1) == 0) {
-            ebl_adc[field_index / 2] = c;
+        if (frame != nullptr) {
+            if ((field_index & 1) == 0) {
+                frame->adc[field_index / 2] = c;
 
-        } else {
-            ebl_adc[field_index / 2] += (uint16_t)c << 8;
+            } else {
+                frame->adc[field_index / 2] += (uint16_t)c << 8;
+            }
         }
 
-        if (++field_index == 16) {
+        if (++field_index == packet_adc_size) {
             state = WAIT_C1;
         }
 
         break;
 
     case WAIT_C1:
-        // subtract this byte from the running sum, since it shouldn't be included
-        running_sum -= c;
-
-        // this is the high byte of the running sum, so subtract it out
-        running_sum -= (c << 8);
+        checksum_hi = c;
         state = WAIT_C2;
         break;
 
     case WAIT_C2:
-        // subtract this byte from the running sum, since it shouldn't be included
-        running_sum -= c;
-
-        // ths is the low byte of the running sum, so should be equal
-        if (running_sum == c) {
-            updated = true;
+        if (packet_checksum_ok(running_sum, checksum_hi, c)) {
             good_packets++;
+            Trace::record(Trace::EV_PACKET, 0, good_packets);
+
+            if (frame != nullptr) {
+                frame->sequence = good_packets;
+                Capture::frame(*frame);
+                publish(frame);
+                frame = nullptr;
+            }
 
         } else {
             bad_packets++;
+            Trace::record(Trace::EV_PACKET, 1, bad_packets);
         }
 
         state = WAIT_H1;
@@ -148,186 +162,82 @@ decode(uint8_t c)
     }
 }
 
-bool
-was_updated()
-{
-    if (updated) {
-        updated = false;
-        return true;
-    }
-
-    return false;
-}
-
-unsigned
-engine_speed()
+namespace
 {
-    // below 6375 rpm could use byte_1c * 25...
-    return ebl_mem[0xf3] * 31U + ebl_mem[0xf3] / 4;
-}
 
-unsigned
-ground_speed()
+// Receiver, a task in the timer process; it decodes the serial data a
+// batch at a time so that other timer callbacks are not held up.
+//
+// The receive interrupt wakes it, through deferred work, for the first
+// byte after it goes idle. While data keeps arriving it drains the
+// buffer every tick instead, rather than being woken for each byte.
+class Receiver : public Task
 {
-    return ebl_mem[0x34];
-}
+public:
+    Receiver() : Task("ebl") {}
 
-unsigned
-oil_pressure()
-{
-    // 10-bit ADC reading 0-5V
-    // 100psi sensor over the range 0.5-4V
-    // 0.5V = 102.4 counts
-    // 4.5V = 921.6 counts
-    // span is 819.2 counts, conversion is / 8.192
+protected:
+    Action                      run() override;
 
-    unsigned counts = ebl_adc[2];
+private:
+    static const unsigned       batch_size = 32;
 
-    // XXX should record a local DTC for out-of-bounds values?
-    if (counts > 102) {
-        counts -= 102;
-
-    } else if (counts > 921) {
-        counts = 921;
-    }
+    bool                        drain();
+};
 
-    float pressure = counts / 8.192F;
+Receiver receiver;
 
-    return roundf(pressure);
+void
+rx_wake(void *arg __unused)
+{
+    receiver.wake();
 }
 
-unsigned
-water_temperature()
+DeferredWork rx_work("ebl rx", rx_wake);
+
+// decode a batch; true if there may be more waiting
+bool
+Receiver::drain()
 {
-    float temperature = ebl_mem[0xe3] * 0.75F - 40;
+    uint8_t buf[batch_size];
+    auto len = gBoard->com_read(buf, sizeof(buf));
 
-    if (temperature < 0) {
-        return 0;
+    for (unsigned i = 0; i < len; i++) {
+        decode(buf[i]);
     }
 
-    return roundf(temperature);
+    return len == batch_size;
 }
 
-unsigned
-voltage()
+Task::Action
+Receiver::run()
 {
-    return ebl_mem[0x45];
-}
+    TASK_BEGIN();
 
-unsigned
-afr()
-{
-    // 10-bit ADC reading 0-5V
-    // Zeitronix AFR default output mode, AFR is 2 * voltage + 9.6
-    // 0V = 9.6:1
-    // 5V = 19.6:1
-    // span is 1024 counts, conversion is / 102.4 + 9.6
+    for (;;) {
+        gBoard->com_rx_notify(&rx_work);
+        TASK_WAIT_UNTIL(gBoard->com_rx_pending());
 
-    unsigned counts = ebl_adc[1];
+        do {
+            if (drain()) {
+                TASK_YIELD();
 
-    float ratio = counts / 102.4F + 9.6F;
+            } else {
+                TASK_SLEEP(1);
+            }
+        } while (gBoard->com_rx_pending());
+    }
 
-    return roundf(ratio * 10);
+    TASK_END();
 }
 
-bool
-ses_set()
-{
-    return ebl_mem[0x0b] & 0x1;
-}
+} // namespace
 
-bool
-engine_running()
+void
+init()
 {
-    return ebl_mem[0x01] & 0x80;
+    receiver.start();
 }
 
-const char *
-dtc_string(uint8_t dtc_index)
-{
-    // sort into priority order
-
-    if ((ebl_mem[0x12] & 0x01) && (dtc_index-- == 0)) {
-        return "VSS   ";
-    }
-
-    if ((ebl_mem[0x12] & 0x02) && (dtc_index-- == 0)) {
-        return "IAT LO";
-    }
-
-    if ((ebl_mem[0x12] & 0x04) && (dtc_index-- == 0)) {
-        return "TPS LO";
-    }
-
-    if ((ebl_mem[0x12] & 0x08) && (dtc_index-- == 0)) {
-        return "TPS HI";
-    }
-
-    if ((ebl_mem[0x12] & 0x10) && (dtc_index-- == 0)) {
-        return "CTS LO";
-    }
-
-    if ((ebl_mem[0x12] & 0x20) && (dtc_index-- == 0)) {
-        return "CTS HI";
-    }
-
-    if ((ebl_mem[0x12] & 0x40) && (dtc_index-- == 0)) {
-        return "O2    ";
-    }
-
-    if ((ebl_mem[0x12] & 0x80) && (dtc_index-- == 0)) {
-        return "DRP   ";
-    }
-
-    if ((ebl_mem[0x13] & 0x01) && (dtc_index-- == 0)) {
-        return "EST   ";
-    }
-
-    if ((ebl_mem[0x13] & 0x08) && (dtc_index-- == 0)) {
-        return "MAP LO";
-    }
-
-    if ((ebl_mem[0x13] & 0x10) && (dtc_index-- == 0)) {
-        return "MAP HI";
-    }
-
-    if ((ebl_mem[0x13] & 0x80) && (dtc_index-- == 0)) {
-        return "IAT HI";
-    }
-
-    if ((ebl_mem[0x14] & 0x01) && (dtc_index-- == 0)) {
-        return "ADU   ";
-    }
-
-    if ((ebl_mem[0x14] & 0x02) && (dtc_index-- == 0)) {
-        return "FP RLY";
-    }
-
-    if ((ebl_mem[0x14] & 0x04) && (dtc_index-- == 0)) {
-        return "VATS  ";
-    }
-
-    if ((ebl_mem[0x14] & 0x08) && (dtc_index-- == 0)) {
-        return "CALPAK";
-    }
-
-    if ((ebl_mem[0x14] & 0x10) && (dtc_index-- == 0)) {
-        return "PROM  ";
-    }
-
-    if ((ebl_mem[0x14] & 0x20) && (dtc_index-- == 0)) {
-        return "O2 RH ";
-    }
-
-    if ((ebl_mem[0x14] & 0x40) && (dtc_index-- == 0)) {
-        return "O2 LN ";
-    }
-
-    if ((ebl_mem[0x14] & 0x80) && (dtc_index-- == 0)) {
-        return "ESC   ";
-    }
-
-    return nullptr;
-}
 } // namespace EBL
 
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ebl_channels.cpp
+ *
+ * Conversion of decoded EBL frames to engineering units.
+ *
+ * Kept apart from the decoder so that host tools can share it.
+ */
+
+#include "EBLmon.h"
+#include "frame.h"
+#include "settings.h"
+
+#include <math.h>
+
+namespace EBL
+{
+
+unsigned
+engine_speed(const Frame &frame)
+{
+    // below 6375 rpm could use byte_1c * 25...
+    return frame.mem[0xf3] * 31U + frame.mem[0xf3] / 4;
+}
+
+unsigned
+ground_speed(const Frame &frame)
+{
+    return frame.mem[0x34];
+}
+
+unsigned
+oil_pressure(const Frame &frame)
+{
+    // 10-bit ADC reading 0-5V
+    // default is a 100psi sensor over the range 0.5-4.5V
+    // 0.5V = 102.4 counts
+    // 4.5V = 921.6 counts
+    // span is 819.2 counts, conversion is / 8.192
+    // calibration comes from settings, in tenths of a count
+
+    unsigned zero = Settings::get(Settings::SET_OIL_ZERO);
+    unsigned full = Settings::get(Settings::SET_OIL_FULL);
+    unsigned counts = frame.adc[2] * 10U;
+
+    if (full <= zero) {
+        return 0;
+    }
+
+    // XXX should record a local DTC for out-of-bounds values?
+    // readings above full scale are not clamped
+    if (counts < zero) {
+        counts = zero;
+    }
+
+    float pressure = (float)(counts - zero) * Settings::get(Settings::SET_OIL_RANGE) / (full - zero);
+
+    return roundf(pressure);
+}
+
+unsigned
+water_temperature(const Frame &frame)
+{
+    float temperature = frame.mem[0xe3] * 0.75F - 40;
+
+    if (temperature < 0) {
+        return 0;
+    }
+
+    return roundf(temperature);
+}
+
+unsigned
+voltage(const Frame &frame)
+{
+    return frame.mem[0x45];
+}
+
+unsigned
+afr(const Frame &frame)
+{
+    // 10-bit ADC reading 0-5V
+    // linear from SET_AFR_LOW at 0V to SET_AFR_HIGH at 5V; by default
+    // the Zeitronix output, AFR is 2 * voltage + 9.6
+
+    int low = Settings::get(Settings::SET_AFR_LOW);
+    int high = Settings::get(Settings::SET_AFR_HIGH);
+    unsigned counts = frame.adc[1];
+
+    float ratio = low + (int)counts * (high - low) / 1024.0F;
+
+    return (ratio > 0) ? roundf(ratio) : 0;
+}
+
+bool
+ses_set(const Frame &frame)
+{
+    return frame.mem[0x0b] & 0x1;
+}
+
+bool
+engine_running(const Frame &frame)
+{
+    return frame.mem[0x01] & 0x80;
+}
+
+const char *
+dtc_string(const Frame &frame, uint8_t dtc_index)
+{
+    // sort into priority order
+
+    if ((frame.mem[0x12] & 0x01) && (dtc_index-- == 0)) {
+        return "VSS   ";
+    }
+
+    if ((frame.mem[0x12] & 0x02) && (dtc_index-- == 0)) {
+        return "IAT LO";
+    }
+
+    if ((frame.mem[0x12] & 0x04) && (dtc_index-- == 0)) {
+        return "TPS LO";
+    }
+
+    if ((frame.mem[0x12] & 0x08) && (dtc_index-- == 0)) {
+        return "TPS HI";
+    }
+
+    if ((frame.mem[0x12] & 0x10) && (dtc_index-- == 0)) {
+        return "CTS LO";
+    }
+
+    if ((frame.mem[0x12] & 0x20) && (dtc_index-- == 0)) {
+        return "CTS HI";
+    }
+
+    if ((frame.mem[0x12] & 0x40) && (dtc_index-- == 0)) {
+        return "O2    ";
+    }
+
+    if ((frame.mem[0x12] & 0x80) && (dtc_index-- == 0)) {
+        return "DRP   ";
+    }
+
+    if ((frame.mem[0x13] & 0x01) && (dtc_index-- == 0)) {
+        return "EST   ";
+    }
+
+    if ((frame.mem[0x13] & 0x08) && (dtc_index-- == 0)) {
+        return "MAP LO";
+    }
+
+    if ((frame.mem[0x13] & 0x10) && (dtc_index-- == 0)) {
+        return "MAP HI";
+    }
+
+    if ((frame.mem[0x13] & 0x80) && (dtc_index-- == 0)) {
+        return "IAT HI";
+    }
+
+    if ((frame.mem[0x14] & 0x01) && (dtc_index-- == 0)) {
+        return "ADU   ";
+    }
+
+    if ((frame.mem[0x14] & 0x02) && (dtc_index-- == 0)) {
+        return "FP RLY";
+    }
+
+    if ((frame.mem[0x14] & 0x04) && (dtc_index-- == 0)) {
+        return "VATS  ";
+    }
+
+    if ((frame.mem[0x14] & 0x08) && (dtc_index-- == 0)) {
+        return "CALPAK";
+    }
+
+    if ((frame.mem[0x14] & 0x10) && (dtc_index-- == 0)) {
+        return "PROM  ";
+    }
+
+    if ((frame.mem[0x14] & 0x20) && (dtc_index-- == 0)) {
+        return "O2 RH ";
+    }
+
+    if ((frame.mem[0x14] & 0x40) && (dtc_index-- == 0)) {
+        return "O2 LN ";
+    }
+
+    if ((frame.mem[0x14] & 0x80) && (dtc_index-- == 0)) {
+        return "ESC   ";
+    }
+
+    return nullptr;
+}
+
+} // namespace EBL
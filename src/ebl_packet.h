@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ebl_packet.h
+ *
+ * EBL packet layout (see ebl_format.txt).
+ *
+ *   header                     0x55 0xaa
+ *   mem                        256 bytes, ECU RAM image
+ *   status                     EBL hardware status
+ *   adc                        8 readings, low byte first
+ *   checksum                   16 bits, high byte first; the sum of
+ *                              every byte before it
+ *
+ * The firmware decodes packets a byte at a time as they arrive (see
+ * EBL::decode()); packet_valid() and packet_unpack() check and unpack a
+ * whole packet held in memory for host tools reading captures. Both
+ * use packet_sum() and packet_checksum_ok(), so they agree on what a
+ * good packet is.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "frame.h"
+
+namespace EBL
+{
+
+const uint8_t packet_h1 = 0x55;
+const uint8_t packet_h2 = 0xaa;
+const unsigned packet_mem_size = sizeof(Frame::mem);
+const unsigned packet_adc_size = sizeof(Frame::adc);
+
+const unsigned packet_mem_offset = 2;
+const unsigned packet_status_offset = packet_mem_offset + packet_mem_size;
+const unsigned packet_adc_offset = packet_status_offset + 1;
+const unsigned packet_checksum_offset = packet_adc_offset + packet_adc_size;
+const unsigned packet_size = packet_checksum_offset + 2;
+
+/**
+ * Add a byte to a packet checksum.
+ *
+ * @param sum                   The sum of the packet bytes so far.
+ * @param c                     The next byte before the checksum.
+ * @return                      The new sum.
+ */
+static inline unsigned
+packet_sum(unsigned sum, uint8_t c)
+{
+    return sum + c;
+}
+
+/**
+ * Compare a packet checksum with the one sent.
+ *
+ * The sum is not truncated to 16 bits, so a packet summing to more than
+ * 0xffff never matches.
+ *
+ * @param sum                   The sum of every byte before the checksum.
+ * @param hi                    The checksum high byte, as sent first.
+ * @param lo                    The checksum low byte.
+ */
+static inline bool
+packet_checksum_ok(unsigned sum, uint8_t hi, uint8_t lo)
+{
+    return sum == (((unsigned)hi << 8) | lo);
+}
+
+/**
+ * Check a packet's header and checksum.
+ *
+ * @param p                     packet_size bytes.
+ */
+static inline bool
+packet_valid(const uint8_t *p)
+{
+    if ((p[0] != packet_h1) || (p[1] != packet_h2)) {
+        return false;
+    }
+
+    unsigned sum = 0;
+
+    for (unsigned i = 0; i < packet_checksum_offset; i++) {
+        sum = packet_sum(sum, p[i]);
+    }
+
+    return packet_checksum_ok(sum, p[packet_checksum_offset], p[packet_checksum_offset + 1]);
+}
+
+/**
+ * Unpack a packet into a frame.
+ *
+ * @param p                     A valid packet.
+ * @param frame                 The frame; sequence and refs are left alone.
+ */
+static inline void
+packet_unpack(const uint8_t *p, Frame &frame)
+{
+    memcpy(frame.mem, &p[packet_mem_offset], packet_mem_size);
+
+    for (unsigned i = 0; i < (packet_adc_size / 2); i++) {
+        frame.adc[i] = p[packet_adc_offset + 2 * i] | (p[packet_adc_offset + 2 * i + 1] << 8);
+    }
+}
+
+} // namespace EBL
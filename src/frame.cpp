@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file frame.cpp
+ *
+ * Decoded EBL frames and frame handle queues.
+ */
+
+#include "frame.h"
+#include "pool.h"
+
+namespace EBL
+{
+
+static Pool<sizeof(Frame), EBL_FRAMES> frame_pool;
+static FrameQueueBase *subscribers;
+
+Frame *
+frame_alloc()
+{
+    auto frame = static_cast<Frame *>(frame_pool.alloc_isr());
+
+    if (frame != nullptr) {
+        frame->refs = 1;
+    }
+
+    return frame;
+}
+
+void
+frame_release(Frame *frame)
+{
+    if (__atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        frame_pool.free(frame);
+    }
+}
+
+void
+FrameRef::retain()
+{
+    if (_frame != nullptr) {
+        __atomic_add_fetch(&_frame->refs, 1, __ATOMIC_RELAXED);
+    }
+}
+
+unsigned frames_in_use() { return frame_pool.in_use; }
+unsigned frames_high_water() { return frame_pool.high_water; }
+unsigned frame_alloc_failures() { return frame_pool.failures; }
+
+/****************************************************************************
+ * Queues
+ */
+
+void
+FrameQueueBase::push(Frame *frame)
+{
+    Frame *dropped = nullptr;
+
+    {
+        TCritSect cs;
+
+        if (_count == _depth) {
+            dropped = pop();
+            drops++;
+        }
+
+        __atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+        _slots[(_head + _count) % _depth] = frame;
+        _count++;
+    }
+
+    // may free, so outside the critical section
+    if (dropped != nullptr) {
+        frame_release(dropped);
+    }
+
+    _avail.signal();
+
+    if (_notify != nullptr) {
+        _notify->signal(_notify_bits);
+    }
+}
+
+Frame *
+FrameQueueBase::pop()
+{
+    auto frame = _slots[_head];
+
+    _head = (_head + 1) % _depth;
+    _count--;
+
+    return frame;
+}
+
+FrameRef
+FrameQueueBase::get(timeout_t timeout)
+{
+    TCritSect cs;
+
+    while (_count == 0) {
+        if (!_avail.wait(timeout)) {
+            return FrameRef();
+        }
+    }
+
+    return FrameRef(pop());
+}
+
+FrameRef
+FrameQueueBase::try_get()
+{
+    TCritSect cs;
+
+    if (_count == 0) {
+        return FrameRef();
+    }
+
+    return FrameRef(pop());
+}
+
+void
+subscribe(FrameQueueBase &queue)
+{
+    TCritSect cs;
+
+    queue._next = subscribers;
+    subscribers = &queue;
+}
+
+void
+publish(Frame *frame)
+{
+    for (auto queue = subscribers; queue != nullptr; queue = queue->_next) {
+        queue->push(frame);
+    }
+
+    frame_release(frame);
+}
+
+} // namespace EBL
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file frame.h
+ *
+ * Decoded EBL frames and frame handle queues.
+ *
+ * Each good packet is decoded into a frame taken from a small pool and
+ * published to every subscribed queue. Queues hold counted references
+ * rather than copies, so any number of consumers can see the same frame;
+ * the frame goes back to the pool when the last reference is dropped.
+ *
+ * Frames and queues are for process context only.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <scmRTOS.h>
+#include <event_group.h>
+
+#ifndef EBL_FRAMES
+# define EBL_FRAMES     6       // decoder, display queue, display, telemetry and recorder queues, one spare
+#endif
+
+namespace EBL
+{
+
+struct Frame {
+    uint8_t                     mem[256];       ///< ECU RAM image
+    uint16_t                    adc[8];         ///< auxiliary ADC readings
+    uint32_t                    sequence;       ///< good packet count when decoded
+    volatile uint8_t            refs;
+};
+
+/**
+ * Take a frame from the pool for decoding into.
+ *
+ * @return                      The frame holding one reference, or nullptr
+ *                              if the pool is empty.
+ */
+extern Frame *frame_alloc();
+
+/**
+ * Drop a reference, returning the frame to the pool if it was the last.
+ */
+extern void frame_release(Frame *frame);
+
+/**
+ * Counted reference to a published frame.
+ */
+class FrameRef
+{
+public:
+    FrameRef() : _frame(nullptr) {}
+    FrameRef(const FrameRef &other) : _frame(other._frame) { retain(); }
+    FrameRef(FrameRef &&other) : _frame(other._frame) { other._frame = nullptr; }
+    ~FrameRef() { reset(); }
+
+    FrameRef &operator=(const FrameRef &other)
+    {
+        if (this != &other) {
+            reset();
+            _frame = other._frame;
+            retain();
+        }
+
+        return *this;
+    }
+
+    FrameRef &operator=(FrameRef &&other)
+    {
+        if (this != &other) {
+            reset();
+            _frame = other._frame;
+            other._frame = nullptr;
+        }
+
+        return *this;
+    }
+
+    const Frame                 &operator*() const { return *_frame; }
+    const Frame                 *operator->() const { return _frame; }
+    explicit operator           bool() const { return _frame != nullptr; }
+
+    /**
+     * Drop the reference.
+     */
+    void                        reset()
+    {
+        if (_frame != nullptr) {
+            frame_release(_frame);
+            _frame = nullptr;
+        }
+    }
+
+private:
+    friend class FrameQueueBase;
+
+    /** adopt a reference that the caller already holds */
+    explicit FrameRef(Frame *frame) : _frame(frame) {}
+
+    void                        retain();
+
+    Frame                       *_frame;
+};
+
+/**
+ * Queue of frames for one consumer.
+ *
+ * When the queue is full the oldest frame is dropped; the decoder never
+ * waits for a slow consumer.
+ */
+class FrameQueueBase
+{
+public:
+    /**
+     * Wait for the next frame.
+     *
+     * @param timeout           Ticks to wait, 0 to wait forever.
+     * @return                  The frame, or an empty reference on timeout.
+     */
+    FrameRef                    get(timeout_t timeout = 0);
+
+    /**
+     * Fetch the next frame without waiting.
+     *
+     * @return                  The frame, or an empty reference if there
+     *                          is none.
+     */
+    FrameRef                    try_get();
+
+    /**
+     * Also signal an event group when a frame is queued, so that the
+     * consumer can wait for frames alongside other events.
+     *
+     * @param group             The event group.
+     * @param bits              Events to signal.
+     */
+    void                        notify(OS::TEventGroup &group, OS::TEventGroup::TBits bits)
+    {
+        _notify = &group;
+        _notify_bits = bits;
+    }
+
+    /** frames dropped because the consumer fell behind */
+    unsigned                    drops = 0;
+
+protected:
+    FrameQueueBase(Frame **slots, uint8_t depth) :
+        _slots(slots),
+        _depth(depth)
+    {
+    }
+
+private:
+    friend void                 subscribe(FrameQueueBase &queue);
+    friend void                 publish(Frame *frame);
+
+    Frame                       **const _slots;
+    const uint8_t               _depth;
+    uint8_t                     _head = 0;
+    uint8_t                     _count = 0;
+    OS::TEventFlag              _avail;
+    OS::TEventGroup             *_notify = nullptr;
+    OS::TEventGroup::TBits      _notify_bits = 0;
+    FrameQueueBase              *_next = nullptr;
+
+    void                        push(Frame *frame);
+    Frame                       *pop();
+};
+
+template <uint8_t DEPTH>
+class FrameQueue : public FrameQueueBase
+{
+public:
+    FrameQueue() : FrameQueueBase(_storage, DEPTH) {}
+
+private:
+    Frame                       *_storage[DEPTH];
+};
+
+/**
+ * Start delivering published frames to a queue.
+ */
+extern void subscribe(FrameQueueBase &queue);
+
+/**
+ * Publish a decoded frame to all subscribed queues.
+ *
+ * Consumes the caller's reference.
+ */
+extern void publish(Frame *frame);
+
+/** frames in use, most ever in use, and packets lost for want of a frame */
+extern unsigned frames_in_use();
+extern unsigned frames_high_water();
+extern unsigned frame_alloc_failures();
+
+} // namespace EBL
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file latency.cpp
+ *
+ * Interrupt latency statistics.
+ *
+ * The hooks run with interrupts masked, so they must not use critical
+ * sections themselves. Their own cost is included in the spans they
+ * measure.
+ */
+
+#include "board.h"
+#include "latency.h"
+
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE == 1
+
+namespace Latency
+{
+
+namespace
+{
+// masked spans
+bool            span_active;
+uint32_t        span_start;
+uintptr_t       span_site;
+Histogram       masked;
+uintptr_t       masked_max_site;
+Site            sites[max_sites];
+uint32_t        sites_dropped;          // spans from sites that didn't fit
+
+// serial receive latency
+uint32_t        char_time;
+uint32_t        rx_expected;            // when the last character was due
+bool            rx_clocked;
+Histogram       rx_latency;
+uint32_t        rx_samples;
+uint32_t        rx_overruns;
+} // namespace
+
+void
+Histogram::add(uint32_t cycles)
+{
+    unsigned bucket = (cycles > 1) ? (31 - __builtin_clz(cycles)) : 0;
+
+    if (bucket >= histogram_buckets) {
+        bucket = histogram_buckets - 1;
+    }
+
+    buckets[bucket]++;
+
+    if (cycles > max) {
+        max = cycles;
+    }
+}
+
+static void
+charge_site(uintptr_t address, uint32_t cycles)
+{
+    for (auto &site : sites) {
+        if (site.address == 0) {
+            site.address = address;
+        }
+
+        if (site.address == address) {
+            site.count++;
+
+            if (cycles > site.max) {
+                site.max = cycles;
+            }
+
+            return;
+        }
+    }
+
+    sites_dropped++;
+}
+
+void
+set_char_time(uint32_t cycles)
+{
+    char_time = cycles;
+    rx_clocked = false;
+}
+
+void
+serial_rx_entry(uint32_t entry, bool overrun)
+{
+    if (overrun) {
+        rx_overruns++;
+    }
+
+    if (char_time == 0) {
+        return;
+    }
+
+    // allow for the sender's clock being up to ~3% slow
+    auto late = entry - (rx_expected + char_time + char_time / 32);
+
+    // a pause on the line; restart the receive clock
+    if (!rx_clocked || (((int32_t)late > 0) && (late >= char_time))) {
+        rx_expected = entry;
+        rx_clocked = true;
+        return;
+    }
+
+    if ((int32_t)late <= 0) {
+        // no later than the clock allows, and the clock is no later
+        // than this character
+        rx_expected = entry;
+        late = 0;
+
+    } else {
+        rx_expected += char_time + char_time / 32;
+    }
+
+    rx_latency.add(late);
+    rx_samples++;
+}
+
+static void
+print_histogram(const char *name, const Histogram &h)
+{
+    auto &b = h.buckets;
+
+    static_assert(histogram_buckets == 16, "format below expects 16 buckets");
+    debug("%s max %lu: %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu",
+          name, (unsigned long)h.max,
+          (unsigned long)b[0], (unsigned long)b[1], (unsigned long)b[2], (unsigned long)b[3],
+          (unsigned long)b[4], (unsigned long)b[5], (unsigned long)b[6], (unsigned long)b[7],
+          (unsigned long)b[8], (unsigned long)b[9], (unsigned long)b[10], (unsigned long)b[11],
+          (unsigned long)b[12], (unsigned long)b[13], (unsigned long)b[14], (unsigned long)b[15]);
+}
+
+void
+report()
+{
+    Histogram masked_copy, rx_copy;
+    Site sites_copy[max_sites];
+    uintptr_t max_site;
+
+    {
+        TCritSect cs;
+
+        masked_copy = masked;
+        rx_copy = rx_latency;
+        max_site = masked_max_site;
+
+        for (unsigned i = 0; i < max_sites; i++) {
+            sites_copy[i] = sites[i];
+        }
+    }
+
+    auto cpu = gBoard->cycles_per_us();
+
+    debug("irq masked max %lu us at %08lx, %lu from untracked sites",
+          (unsigned long)(masked_copy.max / cpu), (unsigned long)max_site,
+          (unsigned long)sites_dropped);
+    print_histogram("irq masked cycles log2", masked_copy);
+
+    for (auto &site : sites_copy) {
+        if (site.address != 0) {
+            debug("  %08lx %lu max %lu cycles", (unsigned long)site.address,
+                  (unsigned long)site.count, (unsigned long)site.max);
+        }
+    }
+
+    debug("rx latency max %lu us over %lu chars, %lu overruns",
+          (unsigned long)(rx_copy.max / cpu), (unsigned long)rx_samples,
+          (unsigned long)rx_overruns);
+    print_histogram("rx latency cycles log2", rx_copy);
+}
+
+} // namespace Latency
+
+/****************************************************************************
+ * Kernel hooks
+ */
+
+void
+OS::critsect_enter_user_hook()
+{
+    if (!Latency::span_active) {
+        Latency::span_active = true;
+        Latency::span_site = (uintptr_t)__builtin_return_address(0);
+        Latency::span_start = gBoard->cycle_count();
+    }
+}
+
+void
+OS::critsect_exit_user_hook()
+{
+    if (Latency::span_active) {
+        uint32_t cycles = gBoard->cycle_count() - Latency::span_start;
+
+        Latency::span_active = false;
+
+        if (cycles > Latency::masked.max) {
+            Latency::masked_max_site = Latency::span_site;
+        }
+
+        Latency::masked.add(cycles);
+        Latency::charge_site(Latency::span_site, cycles);
+    }
+}
+
+#endif // scmRTOS_CRITSECT_USER_HOOK_ENABLE
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file latency.h
+ *
+ * Interrupt latency statistics (IRQ_STATS=1 debug builds).
+ *
+ * Every span during which a critical section keeps interrupts masked is
+ * timed with the board cycle counter, added to a log2 histogram and
+ * charged to the critical section's call site, identified by its code
+ * address (look it up with addr2line).
+ *
+ * The serial receive interrupt reports its entry time. While characters
+ * arrive back to back each is received one character time after the
+ * last, so the earliest entry seen sets a receive clock and lateness
+ * against it is the entry latency from RXNE being set, less the minimum
+ * latency. The clock allows for a slow sender, so short delays read a few
+ * percent of a character time low. Idle time between characters looks
+ * like latency; a pause of a whole character time or more restarts the
+ * clock, and a character that late would have been overrun anyway.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <scmRTOS.h>
+
+namespace Latency
+{
+
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE == 1
+
+const unsigned                  histogram_buckets = 16; ///< bucket n: 2^n..2^(n+1)-1 cycles, last is open
+const unsigned                  max_sites = 16;
+
+struct Site {
+    uintptr_t                   address;
+    uint32_t                    count;
+    uint32_t                    max;                    ///< cycles
+};
+
+struct Histogram {
+    uint32_t                    buckets[histogram_buckets];
+    uint32_t                    max;                    ///< cycles
+
+    void                        add(uint32_t cycles);
+};
+
+/**
+ * Set the character time the serial port is running at.
+ */
+extern void set_char_time(uint32_t cycles);
+
+/**
+ * Note entry to the serial receive interrupt.
+ *
+ * @param entry                 Cycle count read first thing in the handler.
+ * @param overrun               The receiver reported an overrun.
+ */
+extern void serial_rx_entry(uint32_t entry, bool overrun);
+
+/**
+ * Print the statistics to the console.
+ */
+extern void report();
+
+#else
+
+static inline void set_char_time(uint32_t cycles __attribute__((unused))) {}
+static inline void serial_rx_entry(uint32_t entry __attribute__((unused)),
+                                   bool overrun __attribute__((unused))) {}
+static inline void report() {}
+
+#endif // scmRTOS_CRITSECT_USER_HOOK_ENABLE
+
+} // namespace Latency
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file layout.cpp
+ *
+ * Channel formatting and layout rendering.
+ */
+
+#include "EBLmon.h"
+#include "board.h"
+#include "layout.h"
+
+#include <string.h>
+
+namespace UI
+{
+
+/*
+ * Numeric channels are fetched from the decoder as unsigned fixed-point
+ * values and formatted with a unit suffix.
+ */
+struct ChannelFormat {
+    unsigned    (*value)(const EBL::Frame &frame);
+    uint8_t     decimals;               // 0 or 1
+    const char  *suffix;
+};
+
+const ChannelFormat channel_formats[] = {
+    { EBL::ground_speed,        0,      "mph"   },      // CH_ROAD_SPEED
+    { EBL::engine_speed,        0,      "rpm"   },      // CH_ENGINE_SPEED
+    { EBL::water_temperature,   0,      "\xb0"  },      // CH_WATER_TEMPERATURE
+    { EBL::oil_pressure,        0,      "#"     },      // CH_OIL_PRESSURE
+    { EBL::voltage,             1,      "v"     },      // CH_BATTERY_VOLTAGE
+    { EBL::afr,                 1,      ""      },      // CH_AIR_FUEL_RATIO
+    { nullptr,                  0,      nullptr },      // CH_STATUS
+};
+static_assert((sizeof(channel_formats) / sizeof(channel_formats[0])) == NUM_CHANNELS,
+              "channel_formats out of step with Channel");
+
+const unsigned channel_text_size = 22;
+char channel_texts[NUM_CHANNELS][channel_text_size] = {
+    "-", "-", "-", "-", "-", "-", "NOT CONNECTED"
+};
+unsigned alert_channels;                // channels showing an alert
+static bool engine_fault;               // SES set in the latest frame
+
+static void
+format_channel(unsigned channel, const EBL::Frame &frame, char *buf)
+{
+    auto format = &channel_formats[channel];
+
+    if (format->value == nullptr) {
+        if (EBL::ses_set(frame)) {
+            sprintf(buf, "CHECK ENGINE [%s]", EBL::dtc_string(frame, 0) ? : "??????");
+
+        } else if (EBL::engine_running(frame)) {
+            sprintf(buf, "OK");
+
+        } else {
+            sprintf(buf, "NOT RUNNING");
+        }
+
+    } else if (format->decimals) {
+        auto value = format->value(frame);
+        sprintf(buf, "%u.%u%s", value / 10, value % 10, format->suffix);
+
+    } else {
+        sprintf(buf, "%u%s", format->value(frame), format->suffix);
+    }
+}
+
+unsigned
+channels_update(const EBL::Frame &frame)
+{
+    unsigned changed = 0;
+
+    engine_fault = EBL::ses_set(frame);
+
+    for (unsigned channel = 0; channel < NUM_CHANNELS; channel++) {
+        char buf[channel_text_size];
+
+        // CHECK ENGINE outranks an alert on the status line
+        if ((alert_channels & (1U << channel)) &&
+            !((channel == CH_STATUS) && engine_fault)) {
+            continue;
+        }
+
+        format_channel(channel, frame, buf);
+
+        if (strcmp(buf, channel_texts[channel])) {
+            strcpy(channel_texts[channel], buf);
+            changed |= 1U << channel;
+        }
+    }
+
+    return changed;
+}
+
+unsigned
+channel_alert(Channel channel, const char *text)
+{
+    alert_channels |= 1U << channel;
+
+    if ((channel == CH_STATUS) && engine_fault) {
+        return 0;
+    }
+
+    if (!strncmp(text, channel_texts[channel], channel_text_size - 1)) {
+        return 0;
+    }
+
+    strncpy(channel_texts[channel], text, channel_text_size - 1);
+    return 1U << channel;
+}
+
+const char *
+channel_text(Channel channel)
+{
+    return channel_texts[channel];
+}
+
+uint8_t
+layout_dirty_pages(const Layout *layout, unsigned changed)
+{
+    uint8_t dirty = 0;
+
+    for (unsigned i = 0; i < layout->count; i++) {
+        auto cell = &layout->cells[i];
+
+        if (changed & (1U << cell->channel)) {
+            dirty |= cell->pages;
+        }
+    }
+
+    return dirty;
+}
+
+void
+layout_draw(u8g_t *u8g, const Layout *layout, uint8_t dirty)
+{
+    auto pb = (u8g_pb_t *)gBoard->u8g_dev()->dev_mem;
+    auto visible = page_span(pb->p.page_y0 / page_height, pb->p.page_y1 / page_height);
+
+    // clean pages are left as they are on the display
+    if (!(visible & dirty)) {
+        return;
+    }
+
+    u8g_SetColorIndex(u8g, 1);
+
+    for (unsigned i = 0; i < layout->count; i++) {
+        auto cell = &layout->cells[i];
+
+        if (!(cell->pages & visible)) {
+            continue;
+        }
+
+        auto text = channel_texts[cell->channel];
+
+        u8g_SetFont(u8g, cell->font);
+        u8g_SetFontPosBaseline(u8g);
+
+        int ascent = u8g_GetFontAscent(u8g);
+        int descent = u8g_GetFontDescent(u8g);
+        int x = cell->x;
+        int y = cell->y + (cell->h + ascent + descent) / 2;
+
+        if (cell->align == ALIGN_CENTER) {
+            x += ((int)cell->w - (int)u8g_GetStrWidth(u8g, text)) / 2;
+        }
+
+        u8g_DrawStr(u8g, (x < 0) ? 0 : x, y, text);
+    }
+}
+
+} // namespace UI
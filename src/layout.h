@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file layout.h
+ *
+ * Table-driven gauge layouts.
+ *
+ * A layout is a constant table of cells, each of which shows one data
+ * channel in a fixed box using a given font. The page span of each cell
+ * is worked out at compile time so that when a channel changes, only the
+ * display pages covered by the cells showing it need to be redrawn.
+ */
+
+#pragma once
+
+#include <u8g.h>
+
+#include "EBLmon.h"
+
+namespace UI
+{
+
+/**
+ * Data channels that cells can display.
+ */
+enum Channel : uint8_t {
+    CH_ROAD_SPEED,
+    CH_ENGINE_SPEED,
+    CH_WATER_TEMPERATURE,
+    CH_OIL_PRESSURE,
+    CH_BATTERY_VOLTAGE,
+    CH_AIR_FUEL_RATIO,
+    CH_STATUS,
+    NUM_CHANNELS
+};
+
+enum CellAlign : uint8_t {
+    ALIGN_LEFT,
+    ALIGN_CENTER
+};
+
+/** height of a display page in pixels */
+const unsigned page_height = 8;
+
+/** mask of display pages first..last */
+constexpr uint8_t
+page_span(unsigned first, unsigned last)
+{
+    return (first > last) ? 0 : ((1U << first) | page_span(first + 1, last));
+}
+
+struct Cell {
+    uint8_t                     x, y, w, h;     ///< bounding box, y down from the top
+    Channel                     channel;
+    const u8g_fntpgm_uint8_t    *font;
+    CellAlign                   align;
+    uint8_t                     pages;          ///< display pages the box covers
+};
+
+/**
+ * Build a cell, working out which display pages it covers.
+ */
+constexpr Cell
+cell(uint8_t x, uint8_t y, uint8_t w, uint8_t h, Channel channel,
+     const u8g_fntpgm_uint8_t *font, CellAlign align = ALIGN_CENTER)
+{
+    return Cell{x, y, w, h, channel, font, align,
+                page_span(y / page_height, (y + h - 1) / page_height)};
+}
+
+struct Layout {
+    const Cell                  *cells;
+    uint8_t                     count;
+};
+
+#define LAYOUT(_cells)  { &_cells[0], sizeof(_cells) / sizeof(_cells[0]) }
+
+/**
+ * Re-format all channels from a decoded frame.
+ *
+ * @param frame                 The latest frame.
+ * @return                      Bitmask of channels whose text changed.
+ */
+extern unsigned channels_update(const EBL::Frame &frame);
+
+/**
+ * Show an alert in place of a channel's data.
+ *
+ * The alert stays up for the rest of the session; frames no longer
+ * update the channel. The exception is the status line, where CHECK
+ * ENGINE is shown instead while the ECU reports a fault, and the alert
+ * returns when the caller next raises it after the fault clears.
+ *
+ * @param channel               The channel to take over.
+ * @param text                  The alert text.
+ * @return                      Bitmask of channels whose text changed.
+ */
+extern unsigned channel_alert(Channel channel, const char *text);
+
+/**
+ * Text currently displayed for a channel.
+ */
+extern const char *channel_text(Channel channel);
+
+/**
+ * Work out which display pages must be redrawn.
+ *
+ * @param layout                The layout being displayed.
+ * @param changed               Bitmask of changed channels.
+ * @return                      Mask of display pages covered by cells
+ *                              showing any of the changed channels.
+ */
+extern uint8_t layout_dirty_pages(const Layout *layout, unsigned changed);
+
+/**
+ * Draw the cells of a layout that fall on the current u8g page.
+ *
+ * Nothing is drawn if none of the display pages in the current u8g page
+ * are dirty; the display driver will not send those pages either.
+ *
+ * @param u8g                   The graphics context.
+ * @param layout                The layout to draw.
+ * @param dirty                 Mask of display pages being redrawn.
+ */
+extern void layout_draw(u8g_t *u8g, const Layout *layout, uint8_t dirty);
+
+} // namespace UI
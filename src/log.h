@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file log.h
+ *
+ * Tokenized console logging.
+ *
+ * debug() does no formatting on the device. The format string of each
+ * call site is placed in the .logstr section, which the linker script
+ * keeps out of the image (an INFO section based at 1, so ID 0 is never
+ * valid), and its address is an ID fixed at link time. The device sends
+ * the ID and the raw arguments; host/logexpand finds the string in the
+ * ELF and formats the line on the host.
+ *
+ * Each call is one COBS-encoded frame ending in 0x00:
+ *
+ *   LOG_FRAME_TEXT  id (16 bits, little-endian)  arguments...
+ *
+ * Integer arguments are sent as the LEB128 varint of their 32-bit value,
+ * so signedness is applied by the conversion in the format string, as
+ * printf would. String arguments are sent as their bytes and a 0.
+ *
+ * Builds for the host, and firmware built with LOG_TOKENIZED=0, print
+ * text as before.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <type_traits>
+
+#ifndef LOG_TOKENIZED
+# ifdef __arm__
+#  define LOG_TOKENIZED 1
+# else
+#  define LOG_TOKENIZED 0
+# endif
+#endif
+
+namespace Log
+{
+
+enum FrameType : uint8_t {
+    LOG_FRAME_TEXT      = 0x01, ///< tokenized debug() line
+    LOG_FRAME_TELEMETRY = 0x02, ///< channel values, see telemetry.h
+    LOG_FRAME_CAPTURE   = 0x03, ///< fault capture frame, see capture.h
+};
+
+/** largest frame payload; arguments that don't fit are cut off */
+const unsigned max_payload = 80;
+
+/**
+ * Frame payload under construction.
+ */
+struct Payload {
+    uint8_t                     buf[max_payload];
+    uint8_t                     len = 0;
+
+    void put(uint8_t c)
+    {
+        if (len < max_payload) {
+            buf[len++] = c;
+        }
+    }
+
+    void put_varint(uint32_t value)
+    {
+        while (value >= 0x80) {
+            put(value | 0x80);
+            value >>= 7;
+        }
+
+        put(value);
+    }
+};
+
+static inline void put_arg(Payload &p, const char *s)
+{
+    do {
+        p.put(*s);
+    } while (*s++ != '\0');
+}
+
+static inline void put_arg(Payload &p, char *s)
+{
+    put_arg(p, static_cast<const char *>(s));
+}
+
+template <typename T>
+static inline void put_arg(Payload &p, T value)
+{
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                  "log arguments are integers or strings");
+    static_assert(sizeof(T) <= sizeof(uint32_t), "log arguments are at most 32 bits");
+    p.put_varint((uint32_t)value);
+}
+
+static inline void put_args(Payload &p __attribute__((unused))) {}
+
+template <typename T, typename... Rest>
+static inline void put_args(Payload &p, T arg, Rest... rest)
+{
+    put_arg(p, arg);
+    put_args(p, rest...);
+}
+
+/**
+ * Frame a payload and queue it on the console.
+ */
+extern void send(const Payload &p);
+
+template <typename... Args>
+static inline void text(uint16_t id, Args... args)
+{
+    Payload p;
+
+    p.put(LOG_FRAME_TEXT);
+    p.put(id & 0xff);
+    p.put(id >> 8);
+    put_args(p, args...);
+    send(p);
+}
+
+/** never called; lets the compiler check arguments against the format */
+extern int check_format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/** frames sent, and frames with arguments cut off */
+extern unsigned frames;
+extern unsigned truncated;
+
+} // namespace Log
+
+#if LOG_TOKENIZED
+# define debug(fmt, args...)                                                    \
+    do {                                                                        \
+        (void)sizeof(Log::check_format(fmt, ##args));                           \
+        static const char _log_fmt[] __attribute__((section(".logstr"), used)) = fmt; \
+        Log::text((uint16_t)(uintptr_t)_log_fmt, ##args);                       \
+    } while (0)
+#else
+# define debug(fmt, args...)    do { printf(fmt "\r\n", ##args); } while (0)
+#endif
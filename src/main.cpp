@@ -33,77 +33,177 @@
  */
 
 #include "board.h"
+#include "boot.h"
+#include "capture.h"
+#include "deferred.h"
+#include "frame.h"
+#include "latency.h"
+#include "perf.h"
+#include "recorder.h"
+#include "retained.h"
+#include "settings.h"
+#include "stackmon.h"
+#include "task.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "timer.h"
 
-extern "C" {
-#include <libopencm3/stm32/rcc.h>
-#include <libopencm3/stm32/gpio.h>
-#include <libopencm3/stm32/usart.h>
-#include <libopencm3/stm32/spi.h>
-}
-typedef OS::process<OS::pr0, 1000> TGUIProc;
-typedef OS::process<OS::pr1, 1000> TCommsProc;
-typedef OS::process<OS::pr2, 1000> TLEDProc;
+typedef OS::process<OS::pr0, 512>  TDeferredProc;
+typedef OS::process<OS::pr1, 1000> TGUIProc;
+typedef OS::process<OS::pr2, 1000> TTimerProc;
 
+TDeferredProc DeferredProc;
 TGUIProc GUIProc;
-TCommsProc CommsProc;
-TLEDProc LEDProc;
+TTimerProc TimerProc;
+
+class Heartbeat : public Task
+{
+public:
+    Heartbeat() : Task("heartbeat") {}
+
+protected:
+    Action                      run() override;
+};
+static Heartbeat heartbeat;
+
+static void reports(void *arg __unused) { DeferredWork::report(); Task::report(); Recorder::report(); }
+static SoftTimer report_timer(reports);
+
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE
+static void latency_report(void *arg __unused) { Latency::report(); }
+static SoftTimer latency_timer(latency_report);
+#endif
 
-extern "C" void
+extern "C" int
 main()
 {
+    Boot::mark(Boot::BOOT_MAIN);
+
+    // before anything can change the retained state
+    Retained::init();
+
+    // may erase flash, which would overrun the serial port once enabled
+    Settings::init();
+
     // condfigure the board
     gBoard->led_set(true);
     gBoard->com_init(57600);
 
+    StackMon::watch(DeferredProc, "defer");
+    StackMon::watch(GUIProc, "ui");
+    StackMon::watch(TimerProc, "timer");
+    StackMon::watch(OS::IdleProc, "idle");
+
+    EBL::init();
+    Capture::init();
+    Recorder::init();
+    Telemetry::init();
+    heartbeat.start();
+    report_timer.start(5000, 5000);
+#if scmRTOS_CRITSECT_USER_HOOK_ENABLE
+    latency_timer.start(5000, 5000);
+#endif
+
     // and start the OS
+    Boot::mark(Boot::BOOT_OS);
     OS::run();
 }
 
-namespace OS
-{
-
-// User interface process, run the LCD and controls
-template <>
-OS_PROCESS void TGUIProc::exec()
+// Heartbeat, a task in the timer process, shared with the EBL decoder;
+// it yields between groups of lines, and never waits for the console
+// (com_tx_policy stays COM_TX_DROP), so it cannot hold up decoding
+Task::Action
+Heartbeat::run()
 {
-    UI::init();
+    TASK_BEGIN();
 
     for (;;) {
-        UI::tick();
-        OS::sleep(10);
+        TASK_SLEEP(500);
+
+        gBoard->led_toggle();
+        debug("%u com %u rx  %u good %u bad", gBoard->com_interrupts, EBL::rx_count, EBL::good_packets, EBL::bad_packets);
+        debug("%u tx %u dropped %u waits", gBoard->com_tx_bytes, gBoard->com_tx_dropped, gBoard->com_tx_waits);
+        debug("%u telemetry %u dropped", Telemetry::sent, Telemetry::dropped);
+        debug("%u captures %u missed", Capture::captures, Capture::missed);
+        debug("%u settings saved %u compactions", Settings::saved, Settings::compactions);
+        debug("%u warm boots %u us retained save max", Retained::warm_boots,
+              Retained::save_cycles_max / gBoard->cycles_per_us());
+        Boot::report();
+        TASK_YIELD();
+
+        StackMon::check();
+        StackMon::print_slack();
+        TASK_YIELD();
+
+        debug("%u timer overruns %u queued max", SoftTimer::overruns, SoftTimer::queue_high_water);
+        debug("%u deferred queued max", DeferredWork::queue_high_water);
+        debug("%u frames %u max %u lost", EBL::frames_in_use(), EBL::frames_high_water(), EBL::frame_alloc_failures());
+        TASK_YIELD();
+
+        {
+            Perf::cpu_load_update();
+            auto deferred = Perf::cpu_load(OS::pr0);
+            auto gui = Perf::cpu_load(OS::pr1);
+            auto timer = Perf::cpu_load(OS::pr2);
+            auto idle = Perf::cpu_load(OS::prIDLE);
+            debug("%u.%u%% deferred %u.%u%% gui %u.%u%% timer %u.%u%% idle",
+                  deferred / 100, (deferred % 100) / 10,
+                  gui / 100, (gui % 100) / 10,
+                  timer / 100, (timer % 100) / 10, idle / 100, (idle % 100) / 10);
+        }
+
+#if scmRTOS_TICKLESS_IDLE_ENABLE
+        {
+            auto &ts = OS::tickless_stats;
+            auto cpu = gBoard->cycles_per_us();
+            debug("%lu sleep %lu long %lu early %lu skipped, wake avg %lu max %lu us",
+                  (unsigned long)ts.Sleeps, (unsigned long)ts.LongSleeps,
+                  (unsigned long)ts.EarlyWakes, (unsigned long)ts.TicksSkipped,
+                  (unsigned long)(ts.WakeLatencyCount ? (ts.WakeLatencySum / ts.WakeLatencyCount / cpu) : 0),
+                  (unsigned long)(ts.WakeLatencyMax / cpu));
+        }
+#endif
+        TASK_YIELD();
+
+        // a trace dump is printed as the console drains
+        while (Trace::dump_if_requested()) {
+            TASK_SLEEP(TASK_POLL_TICKS);
+        }
+
+        StackMon::dump_if_requested();
     }
+
+    TASK_END();
 }
 
-// Comms process, handle incoming data from the ECU
-template <>
-OS_PROCESS void TCommsProc::exec()
+namespace OS
 {
-    for (;;) {
-        // block waiting for data
-        auto c = gBoard->com_getc();
 
-        // run the decode state machine
-        EBL::decode(c);
-    }
+// Deferred work process, runs work posted by interrupt handlers
+template <>
+OS_PROCESS void TDeferredProc::exec()
+{
+    DeferredWork::run();
 }
 
-// Heartbeat process
+// User interface process, run the LCD and controls
 template <>
-OS_PROCESS void TLEDProc::exec()
+OS_PROCESS void TGUIProc::exec()
 {
+    UI::init();
+
     for (;;) {
-        OS::sleep(500);
-        gBoard->led_toggle();
-        debug("%u com %u rx  %u good %u bad", gBoard->com_interrupts, EBL::rx_count, EBL::good_packets, EBL::bad_packets);
-        debug("%u ui %u ebl %u led", GUIProc.stack_slack() * 4, CommsProc.stack_slack() * 4, LEDProc.stack_slack() * 4);
+        UI::tick();
+        UI::wait();
     }
 }
 
+// Timer process, runs software timer callbacks and the tasks, including
+// the EBL decoder
+template <>
+OS_PROCESS void TTimerProc::exec()
+{
+    SoftTimer::run();
 }
 
-#if scmRTOS_IDLE_HOOK_ENABLE
-void OS::idle_process_user_hook()
-{
-    __WFI();
 }
-#endif
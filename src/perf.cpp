@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file perf.cpp
+ *
+ * Performance instrumentation.
+ */
+
+#include <profiler.h>
+
+#include "board.h"
+#include "perf.h"
+#include "trace.h"
+
+namespace
+{
+
+/*
+ * A 500ms sample is ~36M cycles, which would overflow the profiler's
+ * percentage calculation; scale the counts down by 256 first.
+ */
+class TCPUProfiler : public TProfiler<8>
+{
+public:
+    /**
+     * Called on each context switch, before the outgoing process is
+     * switched out.
+     */
+    INLINE void context_switch()
+    {
+        Trace::record(Trace::EV_SWITCH, cur_proc_priority());
+        advance_counters();
+    }
+
+    /**
+     * Close a sample period.
+     *
+     * The running process is charged up to now. The cycle counter may
+     * not run while the idle process has the core asleep, so any
+     * shortfall against the wall-clock time is charged to idle.
+     *
+     * @param wall_cycles   Cycles elapsed since the previous sample.
+     */
+    INLINE void sample(uint32_t wall_cycles)
+    {
+        {
+            TCritSect cs;
+            uint32_t counted = 0;
+
+            advance_counters();
+
+            for (uint_fast8_t i = 0; i < OS::PROCESS_COUNT; i++)
+                counted += Counter[i];
+
+            if (wall_cycles > counted)
+                Counter[OS::prIDLE] += wall_cycles - counted;
+        }
+        process_data();
+    }
+};
+
+TCPUProfiler profiler;
+uint32_t last_switch;
+tick_count_t last_sample;
+
+} // namespace
+
+template <>
+uint32_t
+TProfiler<8>::time_interval()
+{
+    auto now = gBoard->cycle_count();
+    auto elapsed = now - last_switch;
+
+    last_switch = now;
+    return elapsed;
+}
+
+/*
+ * Charge the time since the previous switch to the outgoing process.
+ */
+void
+OS::context_switch_user_hook()
+{
+    profiler.context_switch();
+}
+
+namespace Perf
+{
+
+void
+cpu_load_update()
+{
+    auto now = OS::get_tick_count();
+    auto ticks = now - last_sample;
+
+    last_sample = now;
+    profiler.sample(ticks * (1000000 / SYSTICKINTRATE) * gBoard->cycles_per_us());
+}
+
+unsigned
+cpu_load(OS::TPriority pr)
+{
+    return profiler.get_result(pr);
+}
+
+} // namespace Perf
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file pool.h
+ *
+ * Fixed-block memory pools.
+ *
+ * A pool hands out blocks of one size from static storage. Free blocks
+ * are kept on a lock-free stack whose head holds a block index and a
+ * change count; the count makes a stale compare-and-swap fail when a block
+ * is taken and returned between reading the head and swapping it (ABA).
+ * Allocation and freeing are O(1) and safe from interrupt handlers without
+ * masking interrupts; only a process that blocks waiting for a block enters
+ * a critical section.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <scmRTOS.h>
+
+template <size_t BLOCK_SIZE, unsigned BLOCKS>
+class Pool
+{
+public:
+    static_assert(BLOCKS > 0 && BLOCKS < 0xffff, "pool must have 1-65534 blocks");
+
+    Pool()
+    {
+        for (unsigned i = 0; i < BLOCKS; i++) {
+            _blocks[i].next = (i + 1 < BLOCKS) ? i + 1 : _empty;
+        }
+
+        _head = 0;
+    }
+
+    /**
+     * Allocate a block without waiting.
+     *
+     * Safe to call from interrupt handlers.
+     *
+     * @return                  The block, or nullptr if the pool is empty.
+     */
+    void                        *alloc_isr()
+    {
+        auto block = take();
+
+        if (block == nullptr) {
+            __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+        }
+
+        return block;
+    }
+
+    /**
+     * Allocate a block, waiting for one to be freed if necessary.
+     *
+     * @param timeout           Ticks to wait, 0 to wait forever.
+     * @return                  The block, or nullptr on timeout.
+     */
+    void                        *alloc(timeout_t timeout = 0)
+    {
+        auto deadline = OS::get_tick_count() + timeout;
+
+        for (;;) {
+            auto block = take();
+
+            if (block != nullptr) {
+                return block;
+            }
+
+            TCritSect cs;
+            timeout_t wait = 0;
+
+            if (timeout > 0) {
+                int32_t remaining = deadline - OS::get_tick_count();
+
+                if (remaining <= 0) {
+                    break;
+                }
+
+                wait = remaining;
+            }
+
+            // a block freed after this is announced; one freed before is taken
+            _waiters++;
+
+            if (index(_head) != _empty) {
+                _waiters--;
+                continue;
+            }
+
+            bool signalled = _freed.wait(wait);
+            _waiters--;
+
+            if (!signalled) {
+                break;
+            }
+        }
+
+        __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+        return nullptr;
+    }
+
+    /**
+     * Return a block to the pool from process context.
+     */
+    void                        free(void *block)
+    {
+        put(block);
+
+        if (_waiters > 0) {
+            _freed.signal();
+        }
+    }
+
+    /**
+     * Return a block to the pool from an interrupt handler.
+     */
+    void                        free_isr(void *block)
+    {
+        put(block);
+
+        if (_waiters > 0) {
+            _freed.signal_isr();
+        }
+    }
+
+    /** size of each block */
+    static constexpr size_t     block_size = BLOCK_SIZE;
+
+    /** number of blocks in the pool */
+    static constexpr unsigned   blocks = BLOCKS;
+
+    /** blocks currently allocated */
+    volatile unsigned           in_use = 0;
+
+    /** most blocks allocated at once */
+    volatile unsigned           high_water = 0;
+
+    /** allocations that found the pool empty or timed out */
+    volatile unsigned           failures = 0;
+
+private:
+    static const uint16_t       _empty = 0xffff;
+
+    union Block {
+        uint8_t                 data[BLOCK_SIZE];
+        uint16_t                next;           ///< while on the free list
+    } __attribute__((aligned));
+
+    Block                       _blocks[BLOCKS];
+    volatile uint32_t           _head;          ///< change count << 16 | first free block
+    volatile unsigned           _waiters = 0;
+    OS::TEventFlag              _freed;
+
+    static uint16_t             index(uint32_t head) { return head & 0xffff; }
+    static uint32_t             make_head(uint32_t old, uint16_t index) { return (old & 0xffff0000) + 0x10000 + index; }
+
+    void                        *take()
+    {
+        uint32_t old = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+        uint16_t i;
+
+        do {
+            i = index(old);
+
+            if (i == _empty) {
+                return nullptr;
+            }
+
+            // may read a block that has just been taken; the swap then fails
+        } while (!__atomic_compare_exchange_n(&_head, &old, make_head(old, _blocks[i].next),
+                                              true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+        // high water is best effort if an interrupt allocates in between
+        auto n = __atomic_add_fetch(&in_use, 1, __ATOMIC_RELAXED);
+
+        if (n > high_water) {
+            high_water = n;
+        }
+
+        return &_blocks[i];
+    }
+
+    void                        put(void *block)
+    {
+        uint16_t i = static_cast<Block *>(block) - &_blocks[0];
+        uint32_t old = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+
+        do {
+            _blocks[i].next = index(old);
+        } while (!__atomic_compare_exchange_n(&_head, &old, make_head(old, i),
+                                              true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+        __atomic_sub_fetch(&in_use, 1, __ATOMIC_RELAXED);
+    }
+};
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file recorder.cpp
+ *
+ * Flight recorder.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "board.h"
+#include "crc.h"
+#include "delta.h"
+#include "frame.h"
+#include "recorder.h"
+#include "task.h"
+
+namespace Recorder
+{
+
+namespace
+{
+
+const unsigned ring_size = 2 * page_data_size;
+const unsigned sector_size = Board::storage_sector_size;
+const unsigned frame_payload = offsetof(EBL::Frame, adc) + sizeof(EBL::Frame::adc);
+
+static_assert(page_size == Board::storage_page_size, "recorder pages must be storage pages");
+static_assert(offsetof(EBL::Frame, adc) == sizeof(EBL::Frame::mem), "frame payload must be contiguous");
+static_assert(frame_payload == Delta::block_size, "frame payload must be a Delta block");
+static_assert(Delta::max_encoded + record_overhead <= ring_size, "frame record does not fit the ring");
+
+class Writer : public Task
+{
+public:
+    Writer() : Task("recorder") {}
+
+    EBL::FrameQueue<1>          frames;
+
+protected:
+    Action                      run() override;
+
+private:
+    uint32_t                    _size = 0;      ///< usable storage, whole sectors
+    uint32_t                    _address = 0;   ///< next page to write
+    uint32_t                    _sequence = 0;  ///< of the next page
+    uint32_t                    _next_record = 0; ///< stream position of the next record header
+    uint32_t                    _flushed_at = 0; ///< tick of the last page written
+    uint32_t                    _started = 0;   ///< cycle count when the current operation began
+    PageHeader                  _header;
+    unsigned                    _chunk = 0;     ///< bytes in the second data chunk
+    Delta::Encoder              _delta;
+    uint8_t                     _coded[Delta::encode_buffer_size];
+
+    bool                        open();
+    bool                        page_due();
+    void                        page_begin();
+    void                        page_end();
+};
+
+Writer writer;
+
+// ring of record data; head and tail are free-running stream positions
+uint8_t ring[ring_size];
+uint32_t head;
+uint32_t tail;
+bool active;
+
+// statistics
+unsigned records;
+unsigned dropped;
+unsigned pages;
+uint32_t frame_bytes;                           // before and after coding
+uint32_t coded_bytes;
+uint32_t encode_max;                            // cycles
+uint32_t write_max;                             // cycles
+uint32_t period_bytes;
+uint32_t period_us;
+
+void
+ring_put(const void *data, unsigned len)
+{
+    auto src = static_cast<const uint8_t *>(data);
+    auto offset = tail % ring_size;
+    auto count = (len < (ring_size - offset)) ? len : (ring_size - offset);
+
+    if (len == 0) {
+        return;
+    }
+
+    memcpy(&ring[offset], src, count);
+
+    if (count < len) {
+        memcpy(&ring[0], src + count, len - count);
+    }
+
+    tail += len;
+}
+
+uint8_t
+ring_byte(uint32_t position)
+{
+    return ring[position % ring_size];
+}
+
+bool
+Writer::open()
+{
+    _size = gBoard->storage_init() & ~(sector_size - 1);
+
+    if (_size < (2 * sector_size)) {
+        debug("recorder: no storage");
+        return false;
+    }
+
+    // the newest sector is the one whose first page has the highest sequence
+    bool found = false;
+    uint32_t newest = 0;
+
+    for (uint32_t address = 0; address < _size; address += sector_size) {
+        PageHeader h;
+
+        gBoard->storage_read(address, &h, sizeof(h));
+
+        if ((h.magic == page_magic) &&
+            (!found || ((int32_t)(h.sequence - _sequence) > 0))) {
+            found = true;
+            newest = address;
+            _sequence = h.sequence;
+        }
+    }
+
+    // carry on from the newest page in it, in the next sector
+    if (found) {
+        for (uint32_t address = newest; address < (newest + sector_size); address += page_size) {
+            PageHeader h;
+
+            gBoard->storage_read(address, &h, sizeof(h));
+
+            if ((h.magic == page_magic) && ((int32_t)(h.sequence - _sequence) >= 0)) {
+                _sequence = h.sequence;
+            }
+        }
+
+        _sequence++;
+        _address = (newest + sector_size) % _size;
+    }
+
+    debug("recorder: %lu KiB, page %lu at %lx", (unsigned long)(_size / 1024),
+          (unsigned long)_sequence, (unsigned long)_address);
+
+    active = true;
+    write(REC_BOOT, nullptr, 0);
+    return true;
+}
+
+bool
+Writer::page_due()
+{
+    auto pending = tail - head;
+
+    // a full page, or a part page if another frame would not fit
+    if ((pending >= page_data_size) ||
+        ((ring_size - pending) < (Delta::max_encoded + record_overhead))) {
+        return true;
+    }
+
+    // don't hold a part page for too long
+    return (pending > 0) && ((OS::get_tick_count() - _flushed_at) >= RECORDER_FLUSH_TICKS);
+}
+
+void
+Writer::page_begin()
+{
+    auto pending = tail - head;
+    auto used = (pending < page_data_size) ? pending : page_data_size;
+    auto end = head + used;
+
+    _header.magic = page_magic;
+    _header.first = no_record;
+    _header.used = used;
+    _header.sequence = _sequence;
+
+    // find the first record that starts in this page, and where the
+    // next one after the page starts
+    while ((int32_t)(_next_record - end) < 0) {
+        if (_header.first == no_record) {
+            _header.first = _next_record - head;
+        }
+
+        _next_record += record_overhead + (ring_byte(_next_record) | (ring_byte(_next_record + 1) << 8));
+    }
+
+    auto offset = head % ring_size;
+    auto count = (used < (ring_size - offset)) ? used : (ring_size - offset);
+
+    _chunk = used - count;
+    gBoard->storage_program(_address + sizeof(PageHeader), &ring[offset], count);
+}
+
+void
+Writer::page_end()
+{
+    period_bytes += sizeof(PageHeader) + _header.used;
+    period_us += (gBoard->cycle_count() - _started) / gBoard->cycles_per_us();
+    pages++;
+
+    {
+        TCritSect cs;
+        head += _header.used;
+    }
+
+    _address = (_address + page_size) % _size;
+    _sequence++;
+    _flushed_at = OS::get_tick_count();
+}
+
+Task::Action
+Writer::run()
+{
+    TASK_BEGIN();
+
+    // with no storage fitted, stay off the frame list rather than queue
+    // frames that are never written
+    if (open()) {
+        EBL::subscribe(frames);
+
+        for (;;) {
+            while (auto frame = frames.try_get()) {
+                auto start = gBoard->cycle_count();
+                auto len = _delta.encode(frame->mem, _coded);
+                auto cycles = gBoard->cycle_count() - start;
+
+                if (cycles > encode_max) {
+                    encode_max = cycles;
+                }
+
+                // a reader can't apply deltas past a lost frame
+                if (!write(REC_FRAME_DELTA, _coded, len)) {
+                    _delta.reset();
+                }
+
+                frame_bytes += frame_payload;
+                coded_bytes += len;
+            }
+
+            if (!page_due()) {
+                TASK_SLEEP(TASK_POLL_TICKS);
+                continue;
+            }
+
+            _started = gBoard->cycle_count();
+
+            // erase sectors as the log reaches them
+            if ((_address % sector_size) == 0) {
+                gBoard->storage_erase(_address);
+                TASK_WAIT_UNTIL(!gBoard->storage_busy());
+            }
+
+            // data first, header last; programs take a millisecond or so,
+            // so keep checking rather than sleep for a tick
+            page_begin();
+
+            while (gBoard->storage_busy()) {
+                TASK_YIELD();
+            }
+
+            if (_chunk > 0) {
+                gBoard->storage_program(_address + sizeof(PageHeader) + _header.used - _chunk, &ring[0], _chunk);
+
+                while (gBoard->storage_busy()) {
+                    TASK_YIELD();
+                }
+            }
+
+            gBoard->storage_program(_address, &_header, sizeof(_header));
+
+            while (gBoard->storage_busy()) {
+                TASK_YIELD();
+            }
+
+            page_end();
+        }
+    }
+
+    TASK_END();
+}
+
+} // namespace
+
+void
+init()
+{
+    writer.start();
+}
+
+bool
+write(RecordType type, const void *payload, unsigned len)
+{
+    auto start = gBoard->cycle_count();
+    RecordHeader h;
+
+    h.length = len;
+    h.type = type;
+    h.check = ~type;
+    h.timestamp = OS::get_tick_count();
+
+    auto crc = CRC::crc16(payload, len, CRC::crc16(&h, sizeof(h)));
+    const uint8_t trailer[2] = { (uint8_t)crc, (uint8_t)(crc >> 8) };
+    auto total = sizeof(h) + len + sizeof(trailer);
+    bool queued = false;
+
+    {
+        TCritSect cs;
+
+        if (!active) {
+            return false;
+        }
+
+        if (total <= (ring_size - (tail - head))) {
+            ring_put(&h, sizeof(h));
+            ring_put(payload, len);
+            ring_put(trailer, sizeof(trailer));
+            records++;
+            queued = true;
+
+        } else {
+            dropped++;
+        }
+
+        auto cycles = gBoard->cycle_count() - start;
+
+        if (cycles > write_max) {
+            write_max = cycles;
+        }
+    }
+
+    return queued;
+}
+
+void
+report()
+{
+    unsigned bytes, us;
+
+    {
+        TCritSect cs;
+
+        bytes = period_bytes;
+        us = period_us;
+        period_bytes = 0;
+        period_us = 0;
+    }
+
+    // bytes per microsecond is MB/s
+    unsigned mbps = us ? (bytes / us) : 0;
+    unsigned mbps_frac = us ? (((bytes % us) * 100) / us) : 0;
+
+    debug("%u recorded %u dropped, %u pages at %u.%02u MB/s, write max %u us",
+          records, dropped + writer.frames.drops, pages, mbps, mbps_frac,
+          (unsigned)(write_max / gBoard->cycles_per_us()));
+    debug("frames coded to %u%%, encode max %u us",
+          frame_bytes ? (unsigned)(((uint64_t)coded_bytes * 100) / frame_bytes) : 0,
+          (unsigned)(encode_max / gBoard->cycles_per_us()));
+}
+
+} // namespace Recorder
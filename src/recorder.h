@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file recorder.h
+ *
+ * Flight recorder.
+ *
+ * Decoded frames, and anything else passed to write(), are logged as
+ * checksummed records to the board's block storage (see Board). Records
+ * are appended to a two-page ring without waiting; a task in the timer
+ * process programs each page of the ring as it fills, early if another
+ * frame would not fit, or after RECORDER_FLUSH_TICKS if data is slow to
+ * arrive. A record that does not fit in the ring is dropped whole.
+ *
+ * Storage is written as a circular log of pages. Each page starts with a
+ * header giving its sequence number, the bytes of record data it holds
+ * and where the first record starting in it begins, so a reader can
+ * put the pages in order and pick up again after a bad or missing page.
+ * The header is programmed last, so a page cut short by a power loss
+ * has none and is ignored. Each boot starts in a fresh sector, after the
+ * newest page, with a REC_BOOT record; sectors are erased as the log
+ * reaches them, oldest data first.
+ *
+ * Frames are recorded Delta coded against the frame before. A session
+ * starts with a key frame, and one follows any dropped frame record.
+ *
+ * Page layout, little-endian:
+ *
+ *   magic                      16 bits, page_magic
+ *   first                      8 bits, offset in the data of the first
+ *                              record header, no_record if none
+ *   used                       8 bits, bytes of record data
+ *   sequence                   32 bits
+ *   data                       record data, used bytes
+ *
+ * Record layout:
+ *
+ *   length                     16 bits, bytes of payload
+ *   type                       8 bits, RecordType
+ *   check                      8 bits, ~type
+ *   timestamp                  32 bits, ticks since boot
+ *   payload                    length bytes
+ *   CRC                        16 bits, CRC::crc16 of all the above
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "EBLmon.h"
+
+#ifndef RECORDER_FLUSH_TICKS
+# define RECORDER_FLUSH_TICKS   1000    // longest data waits for a full page
+#endif
+
+namespace Recorder
+{
+
+const unsigned page_size = 256;
+const uint16_t page_magic = 0x4c46;             // "FL"
+const uint8_t no_record = 0xff;
+
+struct PageHeader {
+    uint16_t                    magic;
+    uint8_t                     first;
+    uint8_t                     used;
+    uint32_t                    sequence;
+};
+static_assert(sizeof(PageHeader) == 8, "PageHeader must be packed");
+
+const unsigned page_data_size = page_size - sizeof(PageHeader);
+
+struct RecordHeader {
+    uint16_t                    length;
+    uint8_t                     type;
+    uint8_t                     check;
+    uint32_t                    timestamp;
+};
+static_assert(sizeof(RecordHeader) == 8, "RecordHeader must be packed");
+
+const unsigned record_overhead = sizeof(RecordHeader) + 2;
+
+enum RecordType : uint8_t {
+    REC_BOOT            = 0x01, ///< start of a session; no payload
+    REC_FRAME           = 0x02, ///< EBL::Frame mem and adc
+    REC_FRAME_DELTA     = 0x03, ///< EBL::Frame mem and adc, Delta coded
+};
+
+/**
+ * Find the end of the log and start recording frames.
+ *
+ * Storage is probed by the recorder task, so nothing is recorded until
+ * the timer process has run.
+ */
+extern void init();
+
+/**
+ * Queue a record.
+ *
+ * Never waits; safe to call from any process.
+ *
+ * @param type                  The record type.
+ * @param payload               The payload.
+ * @param len                   Bytes of payload.
+ * @return                      False if the record was dropped.
+ */
+extern bool write(RecordType type, const void *payload, unsigned len);
+
+/**
+ * Print write throughput, drops and worst-case write() time.
+ */
+extern void report();
+
+} // namespace Recorder
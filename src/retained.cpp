@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file retained.cpp
+ *
+ * State kept across a reset.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "EBLmon.h"
+#include "board.h"
+#include "crc.h"
+#include "retained.h"
+
+namespace Retained
+{
+
+bool warm;
+unsigned warm_boots;
+unsigned save_cycles_max;
+
+namespace
+{
+
+struct State {
+    uint32_t                    magic;
+    uint16_t                    size;           ///< sizeof(State), catches layout changes
+    uint16_t                    crc;            ///< CRC::crc16 of what follows
+    uint32_t                    warm_boots;
+    uint32_t                    rx_count;
+    uint32_t                    good_packets;
+    uint32_t                    bad_packets;
+    uint32_t                    sequence;       ///< of the frame
+    uint8_t                     have_frame;
+    uint8_t                     screen;
+    uint8_t                     mem[sizeof(EBL::Frame::mem)];
+    uint16_t                    adc[8];
+};
+
+const unsigned checked = offsetof(State, warm_boots);
+
+State state __attribute__((section(".noinit")));
+
+void
+seal()
+{
+    state.crc = CRC::crc16(reinterpret_cast<const uint8_t *>(&state) + checked, sizeof(state) - checked);
+}
+
+} // namespace
+
+void
+init()
+{
+    if ((state.magic == magic) &&
+        (state.size == sizeof(state)) &&
+        (CRC::crc16(reinterpret_cast<const uint8_t *>(&state) + checked, sizeof(state) - checked) == state.crc)) {
+        warm = true;
+        warm_boots = ++state.warm_boots;
+        EBL::rx_count = state.rx_count;
+        EBL::good_packets = state.good_packets;
+        EBL::bad_packets = state.bad_packets;
+
+    } else {
+        memset(&state, 0, sizeof(state));
+        state.magic = magic;
+        state.size = sizeof(state);
+    }
+
+    seal();
+}
+
+void
+save_frame(const EBL::Frame &frame)
+{
+    auto start = gBoard->cycle_count();
+
+    // a reset part way through leaves a bad CRC, and the next boot cold
+    state.rx_count = EBL::rx_count;
+    state.good_packets = EBL::good_packets;
+    state.bad_packets = EBL::bad_packets;
+    state.sequence = frame.sequence;
+    state.have_frame = 1;
+    memcpy(state.mem, frame.mem, sizeof(state.mem));
+    memcpy(state.adc, frame.adc, sizeof(state.adc));
+    seal();
+
+    auto cycles = gBoard->cycle_count() - start;
+
+    if (cycles > save_cycles_max) {
+        save_cycles_max = cycles;
+    }
+}
+
+void
+save_screen(uint8_t screen)
+{
+    state.screen = screen;
+    seal();
+}
+
+bool
+restore_frame(EBL::Frame &frame)
+{
+    if (!warm || !state.have_frame) {
+        return false;
+    }
+
+    memcpy(frame.mem, state.mem, sizeof(frame.mem));
+    memcpy(frame.adc, state.adc, sizeof(frame.adc));
+    frame.sequence = state.sequence;
+    return true;
+}
+
+uint8_t
+screen()
+{
+    return state.screen;
+}
+
+} // namespace Retained
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file retained.h
+ *
+ * State kept across a reset.
+ *
+ * A small block of RAM in the .noinit section, which the startup code
+ * leaves alone, holds the last decoded frame, the packet counters and
+ * the gauge screen being shown. It is checked with a magic number and a
+ * CRC at boot. If it is good, this is a warm boot: the counters carry
+ * on, the display skips its reset and self test, and the last frame is
+ * drawn at once rather than leaving the gauges blank until the next
+ * good packet. Otherwise (power on, or a reset during an update) it is
+ * a cold boot and the block is cleared.
+ *
+ * Boot::report() prints whether a boot was warm and when the gauges came
+ * up, which gives the resume time.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "frame.h"
+
+namespace Retained
+{
+
+const uint32_t magic = 0x52455431;              // "RET1"
+
+/**
+ * Check the retained state; call first thing in main().
+ */
+extern void init();
+
+/**
+ * Record the latest frame and the packet counters.
+ *
+ * Copies and CRCs about 300 bytes, an estimated 5000 cycles (70us at
+ * 72MHz), so the UI calls it at most four times a second rather than
+ * for every frame; save_cycles_max holds the measured worst case.
+ * Call from the GUI process.
+ */
+extern void save_frame(const EBL::Frame &frame);
+
+/**
+ * Record the gauge screen being shown.
+ *
+ * Call from the GUI process.
+ */
+extern void save_screen(uint8_t screen);
+
+/**
+ * Fetch the frame saved before the reset.
+ *
+ * @param frame                 Filled with the saved frame.
+ * @return                      False if there is none.
+ */
+extern bool restore_frame(EBL::Frame &frame);
+
+/**
+ * Gauge screen shown before the reset, 0 after a cold boot.
+ */
+extern uint8_t screen();
+
+/** true if the retained state survived the last reset */
+extern bool warm;
+
+/** warm boots since the last cold boot */
+extern unsigned warm_boots;
+
+/** longest save_frame(), in cycles */
+extern unsigned save_cycles_max;
+
+} // namespace Retained
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file settings.cpp
+ *
+ * Persistent settings.
+ */
+
+#include <string.h>
+
+#include "board.h"
+#include "settings.h"
+#include "task.h"
+
+namespace Settings
+{
+
+unsigned saved;
+unsigned compactions;
+
+namespace
+{
+
+const unsigned page_words = Board::settings_page_size / 2;
+const unsigned header_words = 2;
+const uint16_t erased = 0xffff;
+const unsigned quiet_time = 100;                // ms without serial data before an erase
+
+static_assert(NUM_SETTINGS <= 32, "dirty mask too small");
+
+class Writer : public Task
+{
+public:
+    Writer() : Task("settings") {}
+
+    bool                        load();
+    void                        prepare();
+
+protected:
+    Action                      run() override;
+
+private:
+    unsigned                    _page = 0;      ///< active page
+    unsigned                    _next = 0;      ///< word offset of the next record in it
+    uint16_t                    _sequence = 0;  ///< of the active page
+    unsigned                    _key;           ///< being written
+    uint16_t                    _value;
+    unsigned                    _at;            ///< next record in the page being compacted to
+    unsigned                    _i;
+    bool                        _spare_erased = false;
+    unsigned                    _rx;            ///< EBL::rx_count when the line was last seen
+
+    void                        program(unsigned page, unsigned word, uint16_t value)
+    {
+        gBoard->settings_program(page, word * 2, value);
+    }
+};
+
+Writer writer;
+
+uint16_t values[NUM_SETTINGS];                  // the cache
+uint16_t stored[NUM_SETTINGS];                  // as last written to flash
+volatile uint32_t dirty;                        // settings changed since written
+bool have_flash;
+
+bool
+page_valid(const uint16_t *page)
+{
+    return page[0] == page_magic;
+}
+
+bool
+Writer::load()
+{
+    memcpy(values, defaults, sizeof(values));
+    memcpy(stored, defaults, sizeof(stored));
+
+    auto first = gBoard->settings_page(0);
+    auto second = gBoard->settings_page(1);
+
+    if ((first == nullptr) || (second == nullptr)) {
+        return false;
+    }
+
+    bool valid = page_valid(first);
+
+    if (page_valid(second) && (!valid || ((int16_t)(second[1] - first[1]) > 0))) {
+        _page = 1;
+        valid = true;
+    }
+
+    // with nothing written yet, the first save starts a page
+    if (!valid) {
+        _page = 1;
+        _next = page_words;
+        return true;
+    }
+
+    auto page = (_page == 0) ? first : second;
+
+    _sequence = page[1];
+    _next = header_words;
+
+    // later records replace earlier ones; skip any cut short
+    for (unsigned word = header_words; (word + record_words) <= page_words; word += record_words) {
+        uint16_t value = page[word];
+        uint16_t key = page[word + 1];
+
+        if ((value == erased) && (key == erased)) {
+            continue;
+        }
+
+        _next = word + record_words;
+
+        if (((key & 0xff) < NUM_SETTINGS) && ((key >> 8) == (~key & 0xff))) {
+            values[key & 0xff] = value;
+        }
+    }
+
+    memcpy(stored, values, sizeof(stored));
+    return true;
+}
+
+/**
+ * Erase the spare page, if it needs it, while nothing else is running.
+ *
+ * An erase stalls the CPU for up to 40ms, and in that time the serial
+ * port would overrun. At boot the port is not yet enabled, so erasing
+ * here loses nothing and the first compaction of a session never
+ * erases.
+ */
+void
+Writer::prepare()
+{
+    auto spare = gBoard->settings_page(_page ^ 1);
+
+    for (unsigned word = 0; word < page_words; word++) {
+        if (spare[word] != erased) {
+            gBoard->settings_erase(_page ^ 1);
+            break;
+        }
+    }
+
+    _spare_erased = true;
+}
+
+Task::Action
+Writer::run()
+{
+    TASK_BEGIN();
+
+    for (;;) {
+        TASK_WAIT_UNTIL(dirty != 0);
+
+        {
+            TCritSect cs;
+
+            _key = __builtin_ctz(dirty);
+            _value = values[_key];
+            dirty &= ~(1U << _key);
+        }
+
+        if (!have_flash || (_value == stored[_key])) {
+            stored[_key] = _value;
+            continue;
+        }
+
+        // page full; copy the settings that aren't defaults to the other
+        // page, header last
+        if ((_next + record_words) > page_words) {
+
+            // the spare page is erased at boot; a second compaction in a
+            // session waits for a gap in the EBL data to erase it
+            while (!_spare_erased) {
+                _rx = EBL::rx_count;
+                TASK_SLEEP(quiet_time);
+
+                if (EBL::rx_count == _rx) {
+                    gBoard->settings_erase(_page ^ 1);
+                    _spare_erased = true;
+                }
+            }
+
+            _at = header_words;
+
+            for (_i = 0; _i < NUM_SETTINGS; _i++) {
+                if (stored[_i] == defaults[_i]) {
+                    continue;
+                }
+
+                program(_page ^ 1, _at, stored[_i]);
+                TASK_YIELD();
+
+                program(_page ^ 1, _at + 1, _i | ((~_i & 0xff) << 8));
+                TASK_YIELD();
+
+                _at += record_words;
+            }
+
+            program(_page ^ 1, 1, ++_sequence);
+            TASK_YIELD();
+
+            program(_page ^ 1, 0, page_magic);
+            TASK_YIELD();
+
+            _page ^= 1;
+            _next = _at;
+            _spare_erased = false;
+            compactions++;
+        }
+
+        program(_page, _next, _value);
+        TASK_YIELD();
+
+        program(_page, _next + 1, _key | ((~_key & 0xff) << 8));
+        TASK_YIELD();
+
+        _next += record_words;
+        stored[_key] = _value;
+        saved++;
+    }
+
+    TASK_END();
+}
+
+} // namespace
+
+void
+init()
+{
+    have_flash = writer.load();
+
+    if (have_flash) {
+        writer.prepare();
+
+    } else {
+        debug("settings: no flash, using defaults");
+    }
+
+    writer.start();
+}
+
+uint16_t
+get(Key key)
+{
+    return (key < NUM_SETTINGS) ? values[key] : 0;
+}
+
+void
+set(Key key, uint16_t value)
+{
+    if (key >= NUM_SETTINGS) {
+        return;
+    }
+
+    {
+        TCritSect cs;
+
+        values[key] = value;
+        dirty |= 1U << key;
+    }
+
+    writer.wake();
+}
+
+} // namespace Settings
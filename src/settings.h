@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file settings.h
+ *
+ * Persistent settings.
+ *
+ * Settings are 16-bit values cached in RAM. At boot the cache is loaded
+ * from the board's settings flash (see Board), falling back to built-in
+ * defaults; get() only ever reads the cache. set() updates the cache
+ * and leaves a task in the timer process to append the change to flash,
+ * so callers never wait for the flash.
+ *
+ * The flash is two pages used as a log. Changed settings are appended
+ * to the active page as records; when it fills, the latest value of
+ * each setting that differs from its default is copied to the other
+ * page, which then becomes active. Pages are erased only then, so each
+ * erase covers a page's worth of changes.
+ *
+ * Page layout, in 16-bit words, little-endian:
+ *
+ *   magic                      page_magic
+ *   sequence                   counts compactions; the newer of two
+ *                              valid pages is active
+ *   records                    to the end of the page, erased when unused
+ *
+ * Record layout:
+ *
+ *   value                      16 bits
+ *   key                        8 bits, Key
+ *   check                      8 bits, ~key
+ *
+ * A record's value is programmed before its key, and a page's header
+ * after its records, so a write cut short by a reset is ignored.
+ *
+ * Flash cannot be read while it is being programmed or erased, and the
+ * CPU stalls if it tries, interrupts included. Programming a word takes
+ * at most 70us. At 57600 baud the USART holds a received byte for 174us
+ * before the next one overruns it, so a program never loses data. The
+ * task writes one word at a time and yields between them, so the receive
+ * interrupt runs between words.
+ *
+ * Erasing a page holds the CPU for up to 40ms, which would lose a packet.
+ * The spare page is therefore erased by init(), before the serial port
+ * is enabled. That covers the first compaction of a session. A second
+ * compaction in the same session waits until no serial data has arrived
+ * for 100ms before it erases. Until then, changes stay in the cache.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "EBLmon.h"
+
+namespace Settings
+{
+
+enum Key : uint8_t {
+    SET_OIL_ZERO,               ///< oil pressure sensor ADC counts * 10 at 0 psi
+    SET_OIL_FULL,               ///< counts * 10 at full scale
+    SET_OIL_RANGE,              ///< psi at full scale
+    SET_AFR_LOW,                ///< wideband AFR * 10 at 0V
+    SET_AFR_HIGH,               ///< AFR * 10 at 5V
+    NUM_SETTINGS
+};
+
+/** values used until a setting is changed */
+const uint16_t defaults[NUM_SETTINGS] = {
+    1020,                       // SET_OIL_ZERO, 0.5V
+    9212,                       // SET_OIL_FULL, 4.5V; a span of 819.2 counts
+    100,                        // SET_OIL_RANGE
+    96,                         // SET_AFR_LOW, Zeitronix default output
+    196,                        // SET_AFR_HIGH
+};
+
+const uint16_t page_magic = 0x5453;             // "ST"
+const unsigned record_words = 2;
+
+/**
+ * Load settings from flash and start the writer.
+ *
+ * Takes microseconds, or up to 40ms when the spare page needs erasing.
+ * Must be called before the serial port is enabled.
+ */
+extern void init();
+
+/**
+ * Current value of a setting.
+ *
+ * Safe to call from any process.
+ */
+extern uint16_t get(Key key);
+
+/**
+ * Change a setting.
+ *
+ * Never waits; the change is written to flash in the background.
+ * Safe to call from any process.
+ */
+extern void set(Key key, uint16_t value);
+
+/** records written, and times the log was compacted */
+extern unsigned saved;
+extern unsigned compactions;
+
+} // namespace Settings
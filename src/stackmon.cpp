@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file stackmon.cpp
+ *
+ * Process stack watermark monitor.
+ */
+
+#include "board.h"
+#include "stackmon.h"
+
+namespace StackMon
+{
+
+namespace
+{
+struct Watched {
+    const OS::TBaseProcess      *proc;
+    const char                  *name;
+    uint16_t                    size;           // bytes
+    uint16_t                    slack;          // bytes, lowest seen
+};
+
+const unsigned max_watched = OS::PROCESS_COUNT;
+Watched watched[max_watched];
+unsigned watched_count;
+
+// index of the process in alarm with the least slack, or -1
+volatile int alarm_index = -1;
+volatile bool dump_requested;
+
+// recommended sizes are kept 8-aligned for the AAPCS
+unsigned
+recommended_size(const Watched &w)
+{
+    return ((w.size - w.slack) + STACK_MARGIN_BYTES + 7) & ~7U;
+}
+} // namespace
+
+void
+watch(const OS::TBaseProcess &proc, const char *name, size_t size)
+{
+    if (watched_count >= max_watched) {
+        return;
+    }
+
+    auto &w = watched[watched_count];
+    w.proc = &proc;
+    w.name = name;
+    w.size = size;
+    w.slack = size;
+    watched_count++;
+}
+
+void
+check()
+{
+    int worst = -1;
+
+    for (unsigned i = 0; i < watched_count; i++) {
+        auto &w = watched[i];
+
+        // the scan stops at the first overwritten item, so it gets cheaper as usage grows
+        unsigned slack = w.proc->stack_slack() * sizeof(stack_item_t);
+
+        if (slack < w.slack) {
+            w.slack = slack;
+
+            if (slack < STACK_ALARM_BYTES) {
+                debug("stack low %s %u/%u", w.name, slack, w.size);
+            }
+        }
+
+        if ((w.slack < STACK_ALARM_BYTES) && ((worst < 0) || (w.slack < watched[worst].slack))) {
+            worst = i;
+        }
+    }
+
+    alarm_index = worst;
+}
+
+const char *
+alarm()
+{
+    int i = alarm_index;
+
+    return (i < 0) ? nullptr : watched[i].name;
+}
+
+void
+print_slack()
+{
+    for (unsigned i = 0; i < watched_count; i++) {
+        debug("%u %s slack", watched[i].slack, watched[i].name);
+    }
+}
+
+void
+request_dump()
+{
+    dump_requested = true;
+}
+
+void
+dump_if_requested()
+{
+    if (!dump_requested)
+        return;
+
+    dump_requested = false;
+
+    unsigned reclaim = 0;
+
+    debug("stack   size  used  rec");
+
+    for (unsigned i = 0; i < watched_count; i++) {
+        auto &w = watched[i];
+        auto rec = recommended_size(w);
+
+        debug("%-6s %5u %5u %4u", w.name, w.size, w.size - w.slack, rec);
+
+        if (rec < w.size) {
+            reclaim += w.size - rec;
+        }
+    }
+
+    debug("stack reclaimable %u", reclaim);
+}
+
+} // namespace StackMon
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file stackmon.h
+ *
+ * Process stack watermark monitor.
+ *
+ * With scmRTOS_DEBUG_ENABLE each process stack is filled with a pattern
+ * at startup; the pattern below the deepest point the stack has reached
+ * is never disturbed, so the high-water mark can be recovered at any time
+ * by scanning for it. The monitor samples every watched process, raises
+ * an alarm when one comes within STACK_ALARM_BYTES of overflowing, and
+ * on request prints a right-sizing report.
+ */
+
+#pragma once
+
+#include <scmRTOS.h>
+
+#ifndef STACK_ALARM_BYTES
+# define STACK_ALARM_BYTES      128     // alarm when slack falls below this
+#endif
+#ifndef STACK_MARGIN_BYTES
+# define STACK_MARGIN_BYTES     128     // headroom left by recommended sizes
+#endif
+
+namespace StackMon
+{
+
+/**
+ * Add a process to the set being monitored.
+ *
+ * @param proc                  The process.
+ * @param name                  Short name for reports and the alarm.
+ * @param size                  Size of the process stack in bytes.
+ */
+extern void watch(const OS::TBaseProcess &proc, const char *name, size_t size);
+
+template <OS::TPriority pr, size_t stack_size>
+void
+watch(const OS::process<pr, stack_size> &proc, const char *name)
+{
+    watch(proc, name, stack_size);
+}
+
+/**
+ * Sample the stacks of all watched processes.
+ *
+ * Called periodically; since the fill pattern records the deepest point
+ * reached, the sampling rate only affects how quickly an alarm is raised.
+ */
+extern void check();
+
+/**
+ * Name of the process with the least slack, if it is below the alarm
+ * threshold.
+ *
+ * @return                      The process name, or nullptr if no stack
+ *                              is in alarm.
+ */
+extern const char *alarm();
+
+/**
+ * Print the current slack of each watched process.
+ */
+extern void print_slack();
+
+/**
+ * Ask for the right-sizing report to be printed.
+ */
+extern void request_dump();
+
+/**
+ * Print the right-sizing report if one has been requested.
+ *
+ * For each process the report gives the configured size, the most used
+ * so far and a recommended size leaving STACK_MARGIN_BYTES of headroom,
+ * followed by the total that the recommendations would reclaim.
+ */
+extern void dump_if_requested();
+
+} // namespace StackMon
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file task.cpp
+ *
+ * Stackless cooperative tasks.
+ */
+
+#include "board.h"
+#include "task.h"
+
+Task *Task::_list;
+
+Task::Task(const char *name) :
+    _name(name),
+    _timer(resume, this),
+    _next(_list)
+{
+    _list = this;
+}
+
+void
+Task::start()
+{
+    TCritSect cs;
+
+    _resume_at = 0;
+    _timer.fire();
+}
+
+/*
+ * Timer callback; runs the task up to its next blocking call and sets
+ * the timer for when it should carry on.
+ */
+void
+Task::resume(void *arg)
+{
+    auto task = static_cast<Task *>(arg);
+    auto start = gBoard->cycle_count();
+
+    auto action = task->run();
+
+    task->_cycles += gBoard->cycle_count() - start;
+    task->_resumes++;
+
+    switch (action) {
+    case ACT_YIELD:
+        task->_timer.fire();
+        break;
+
+    case ACT_SLEEP:
+        task->_timer.start(task->_sleep);
+        break;
+
+    case ACT_POLL:
+        task->_timer.start(TASK_POLL_TICKS);
+        break;
+
+    case ACT_DONE:
+        break;
+    }
+}
+
+void
+Task::report()
+{
+    auto cpu = gBoard->cycles_per_us();
+    unsigned count = 0;
+
+    for (auto t = _list; t != nullptr; t = t->_next) {
+        debug("%u %s resumes, avg %u us", t->_resumes, t->_name,
+              t->_resumes ? (unsigned)(t->_cycles / t->_resumes / cpu) : 0);
+        count++;
+    }
+
+    debug("%u tasks in %u bytes", count, unsigned(count * sizeof(Task)));
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file task.h
+ *
+ * Stackless cooperative tasks.
+ *
+ * A task is a resumable function in the protothread style: the body is
+ * a switch on a saved resume point, so the task blocks (sleeps, waits
+ * for a condition or yields) by returning, and carries on from the same
+ * place when it is next resumed. Tasks are resumed by their own software
+ * timer and run one at a time in the timer process, on its stack; a
+ * small job costs its Task object rather than a process and stack of
+ * its own.
+ *
+ * Locals do not survive a blocking call, so state that must persist
+ * lives in members of the derived class. A switch statement cannot
+ * span a blocking call either.
+ *
+ *   Task::Action
+ *   Blinker::run()
+ *   {
+ *       TASK_BEGIN();
+ *
+ *       for (;;) {
+ *           gBoard->led_toggle();
+ *           TASK_SLEEP(500);
+ *       }
+ *
+ *       TASK_END();
+ *   }
+ */
+
+#pragma once
+
+#include "timer.h"
+
+#ifndef TASK_POLL_TICKS
+# define TASK_POLL_TICKS        10      // how often TASK_WAIT_UNTIL re-checks
+#endif
+
+class Task
+{
+public:
+    /**
+     * @param name              Short name for the report.
+     */
+    Task(const char *name);
+
+    /**
+     * Run the task from the top.
+     *
+     * Safe to call from interrupt handlers and timer callbacks.
+     */
+    void                        start();
+
+    /**
+     * Resume a sleeping or waiting task now.
+     *
+     * Safe to call from interrupt handlers and timer callbacks.
+     */
+    void                        wake() { _timer.fire(); }
+
+    /**
+     * Print per-task resume counts and times, and the RAM used by tasks.
+     */
+    static void                 report();
+
+protected:
+    enum Action : uint8_t {
+        ACT_YIELD,              ///< resume after other queued work
+        ACT_SLEEP,              ///< resume after _sleep ticks
+        ACT_POLL,               ///< resume after TASK_POLL_TICKS
+        ACT_DONE                ///< finished, until started again
+    };
+
+    /**
+     * The task body, written with the TASK_ macros.
+     */
+    virtual Action              run() = 0;
+
+    uint16_t                    _resume_at = 0; ///< resume point, a line number
+    timeout_t                   _sleep = 0;
+
+private:
+    const char                  *const _name;
+    SoftTimer                   _timer;
+    Task                        *_next;         ///< all tasks, for the report
+    unsigned                    _resumes = 0;
+    uint32_t                    _cycles = 0;    ///< total time running
+
+    static void                 resume(void *arg);
+
+    static Task                 *_list;
+};
+
+#define TASK_BEGIN()            switch (_resume_at) { case 0:
+
+#define TASK_END()              } _resume_at = 0; return ACT_DONE
+
+/** let other tasks and timer callbacks run */
+#define TASK_YIELD()                                                    \
+    do {                                                                \
+        _resume_at = __LINE__; return ACT_YIELD; case __LINE__:;        \
+    } while (0)
+
+/** sleep for at least one tick */
+#define TASK_SLEEP(_ticks)                                              \
+    do {                                                                \
+        _sleep = (_ticks);                                              \
+        _resume_at = __LINE__; return ACT_SLEEP; case __LINE__:;        \
+    } while (0)
+
+/** block until a condition holds, checking every TASK_POLL_TICKS or on wake() */
+#define TASK_WAIT_UNTIL(_cond)                                          \
+    do {                                                                \
+        _resume_at = __LINE__; case __LINE__:                           \
+        if (!(_cond)) return ACT_POLL;                                  \
+    } while (0)
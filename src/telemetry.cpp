@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file telemetry.cpp
+ *
+ * Binary telemetry of decoded channels.
+ */
+
+#include "board.h"
+#include "cobs.h"
+#include "crc.h"
+#include "frame.h"
+#include "task.h"
+#include "telemetry.h"
+
+namespace Telemetry
+{
+
+unsigned sent;
+unsigned dropped;
+
+namespace
+{
+
+const unsigned max_payload = 1 + 1 + 5 + 2 + NUM_FIELDS * 5 + 2;
+
+class Sender : public Task
+{
+public:
+    Sender() : Task("telemetry") {}
+
+    EBL::FrameQueue<1>          frames;
+    timeout_t                   period = TELEMETRY_PERIOD;
+
+protected:
+    Action                      run() override;
+
+private:
+    uint32_t                    _last[NUM_FIELDS];
+    uint8_t                     _count = 0;
+    uint8_t                     _since_key = TELEMETRY_KEYFRAME;  // first message is complete
+
+    void                        send(const EBL::Frame &frame);
+};
+
+Sender sender;
+
+uint8_t *
+put_varint(uint8_t *p, uint32_t value)
+{
+    while (value >= 0x80) {
+        *p++ = value | 0x80;
+        value >>= 7;
+    }
+
+    *p++ = value;
+    return p;
+}
+
+unsigned
+dtc_count(const EBL::Frame &frame)
+{
+    unsigned count = 0;
+
+    while (EBL::dtc_string(frame, count) != nullptr) {
+        count++;
+    }
+
+    return count;
+}
+
+Task::Action
+Sender::run()
+{
+    TASK_BEGIN();
+
+    for (;;) {
+        TASK_WAIT_UNTIL(period != 0);
+        TASK_SLEEP(period);
+
+        // only the latest frame matters
+        if (auto frame = frames.try_get()) {
+            send(*frame);
+        }
+    }
+
+    TASK_END();
+}
+
+void
+Sender::send(const EBL::Frame &frame)
+{
+    const uint32_t values[NUM_FIELDS] = {
+        EBL::engine_speed(frame),
+        EBL::ground_speed(frame),
+        EBL::water_temperature(frame),
+        EBL::oil_pressure(frame),
+        EBL::voltage(frame),
+        EBL::afr(frame),
+        (EBL::ses_set(frame) ? unsigned(STATUS_SES) : 0U) | (EBL::engine_running(frame) ? unsigned(STATUS_RUNNING) : 0U),
+        dtc_count(frame),
+    };
+    static_assert(sizeof(values) / sizeof(values[0]) == NUM_FIELDS, "values out of step with Field");
+
+    bool key = (_since_key >= TELEMETRY_KEYFRAME);
+    unsigned mask = 0;
+
+    for (unsigned i = 0; i < NUM_FIELDS; i++) {
+        if (key || (values[i] != _last[i])) {
+            mask |= 1U << i;
+        }
+    }
+
+    uint8_t payload[max_payload];
+    auto p = payload;
+
+    *p++ = Log::LOG_FRAME_TELEMETRY;
+    *p++ = _count;
+    p = put_varint(p, frame.sequence);
+    p = put_varint(p, mask);
+
+    for (unsigned i = 0; i < NUM_FIELDS; i++) {
+        if (mask & (1U << i)) {
+            p = put_varint(p, values[i]);
+        }
+    }
+
+    auto crc = CRC::crc16(payload, p - payload);
+    *p++ = crc & 0xff;
+    *p++ = crc >> 8;
+
+    // leading delimiter too, in case text was sent before
+    uint8_t buf[COBS::max_encoded(max_payload) + 2];
+    auto len = COBS::encode(payload, p - payload, &buf[1]) + 1;
+    buf[0] = 0;
+    buf[len++] = 0;
+
+    // the count moves on regardless, so that the receiver sees the gap
+    _count++;
+
+    if (!gBoard->com_write_frame(buf, len)) {
+        dropped++;
+        _since_key = TELEMETRY_KEYFRAME;
+        return;
+    }
+
+    sent++;
+    _since_key = key ? 1 : (_since_key + 1);
+
+    for (unsigned i = 0; i < NUM_FIELDS; i++) {
+        _last[i] = values[i];
+    }
+}
+
+} // namespace
+
+void
+init()
+{
+    EBL::subscribe(sender.frames);
+    sender.start();
+}
+
+void
+set_period(timeout_t period)
+{
+    sender.period = period;
+    sender.wake();
+}
+
+} // namespace Telemetry
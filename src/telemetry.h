@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file telemetry.h
+ *
+ * Binary telemetry of decoded channels on the console.
+ *
+ * Telemetry shares the serial transmit ring with the tokenized console
+ * (see log.h); each message is a COBS-encoded frame between 0x00
+ * delimiters, so it can also be picked out of a text console, with the
+ * payload:
+ *
+ *   LOG_FRAME_TELEMETRY
+ *   count                      8 bits, counts messages sent
+ *   sequence                   varint, EBL good packet count of the frame
+ *   mask                       varint, bit n set if field n follows
+ *   values...                  varint per field in the mask, in field order
+ *   CRC                        16 bits little-endian, CRC::crc16 of the above
+ *
+ * Only fields that changed since the last message are sent. Every
+ * TELEMETRY_KEYFRAME messages, and after a message has been dropped,
+ * all fields are sent; a receiver that sees a gap in the count holds
+ * its values as stale until the next complete message.
+ *
+ * Messages are sent from a task in the timer process and are queued
+ * without waiting; when the transmit ring is full they are dropped.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "EBLmon.h"
+
+#ifndef TELEMETRY_PERIOD
+# define TELEMETRY_PERIOD       100     // ticks between messages, 0 for off
+#endif
+#ifndef TELEMETRY_KEYFRAME
+# define TELEMETRY_KEYFRAME     20      // messages between complete messages
+#endif
+
+namespace Telemetry
+{
+
+/**
+ * Telemetry fields, in the order they are sent.
+ */
+enum Field : uint8_t {
+    F_ENGINE_SPEED,             ///< rpm
+    F_ROAD_SPEED,               ///< mph
+    F_WATER_TEMPERATURE,        ///< degrees C
+    F_OIL_PRESSURE,             ///< psi
+    F_VOLTAGE,                  ///< decivolts
+    F_AFR,                      ///< air/fuel ratio * 10
+    F_STATUS,                   ///< STATUS_ flags
+    F_DTC_COUNT,                ///< trouble codes set
+    NUM_FIELDS
+};
+
+enum Status : uint8_t {
+    STATUS_SES          = 0x01, ///< service engine soon light is on
+    STATUS_RUNNING      = 0x02, ///< engine is running
+};
+
+/**
+ * Subscribe to decoded frames and start sending.
+ */
+extern void init();
+
+/**
+ * Change the message rate.
+ *
+ * A message is only sent if a new frame has been decoded since the last,
+ * so the rate is also limited by the ECU.
+ *
+ * @param period                Ticks between messages, 0 to stop sending.
+ */
+extern void set_period(timeout_t period);
+
+/** messages sent, and messages dropped for want of room */
+extern unsigned sent;
+extern unsigned dropped;
+
+} // namespace Telemetry
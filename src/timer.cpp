@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file timer.cpp
+ *
+ * Software timers.
+ */
+
+#include "timer.h"
+
+unsigned        SoftTimer::overruns;
+unsigned        SoftTimer::queue_high_water;
+SoftTimer       *SoftTimer::_running;
+SoftTimer       *SoftTimer::_queue_head;
+SoftTimer       *SoftTimer::_queue_tail;
+unsigned        SoftTimer::_queue_depth;
+OS::TEventFlag  SoftTimer::_queue_event;
+
+void
+SoftTimer::start(timeout_t ticks, timeout_t period)
+{
+    TCritSect cs;
+
+    if (_active) {
+        remove();
+    }
+
+    _period = period;
+    insert((ticks > 0) ? ticks : 1);
+}
+
+void
+SoftTimer::stop()
+{
+    TCritSect cs;
+
+    if (_active) {
+        remove();
+    }
+
+    _period = 0;
+
+    if (_queued) {
+        SoftTimer **pp = &_queue_head;
+        SoftTimer *prev = nullptr;
+
+        while (*pp != this) {
+            prev = *pp;
+            pp = &prev->_next_queued;
+        }
+
+        *pp = _next_queued;
+
+        if (_queue_tail == this) {
+            _queue_tail = prev;
+        }
+
+        _queued = false;
+        _queue_depth--;
+    }
+}
+
+void
+SoftTimer::fire()
+{
+    TCritSect cs;
+
+    if (_active) {
+        remove();
+    }
+
+    expire();
+}
+
+bool
+SoftTimer::running() const
+{
+    return _active;
+}
+
+/*
+ * Insert into the running list, keeping it sorted by expiry. The cost is
+ * linear in the number of running timers, but paid by start() and
+ * periodic reloads rather than by every tick.
+ */
+void
+SoftTimer::insert(timeout_t ticks)
+{
+    SoftTimer **pp = &_running;
+
+    // timers expiring on the same tick fire in the order they were started
+    while ((*pp != nullptr) && ((*pp)->_delta <= ticks)) {
+        ticks -= (*pp)->_delta;
+        pp = &(*pp)->_next;
+    }
+
+    _delta = ticks;
+    _next = *pp;
+
+    if (_next != nullptr) {
+        _next->_delta -= ticks;
+    }
+
+    *pp = this;
+    _active = true;
+}
+
+void
+SoftTimer::remove()
+{
+    SoftTimer **pp = &_running;
+
+    while (*pp != this) {
+        pp = &(*pp)->_next;
+    }
+
+    *pp = _next;
+
+    if (_next != nullptr) {
+        _next->_delta += _delta;
+    }
+
+    _active = false;
+}
+
+/*
+ * Called with the timer already taken off the running list.
+ */
+void
+SoftTimer::expire()
+{
+    _active = false;
+
+    if (_period > 0) {
+        insert(_period);
+    }
+
+    if (_context == CTX_TICK) {
+        _callback(_arg);
+        return;
+    }
+
+    // still waiting from the last expiry
+    if (_queued) {
+        overruns++;
+        return;
+    }
+
+    _queued = true;
+    _next_queued = nullptr;
+
+    if (_queue_tail != nullptr) {
+        _queue_tail->_next_queued = this;
+
+    } else {
+        _queue_head = this;
+    }
+
+    _queue_tail = this;
+
+    if (++_queue_depth > queue_high_water) {
+        queue_high_water = _queue_depth;
+    }
+
+    _queue_event.signal_isr();
+}
+
+void
+SoftTimer::tick()
+{
+    TCritSect cs;
+
+    if (_running == nullptr) {
+        return;
+    }
+
+    // only the head counts down; anything behind it with no ticks
+    // of its own expires at the same time
+    _running->_delta--;
+
+    while ((_running != nullptr) && (_running->_delta == 0)) {
+        auto t = _running;
+        _running = t->_next;
+        t->expire();
+    }
+}
+
+timeout_t
+SoftTimer::nearest()
+{
+    return (_running != nullptr) ? _running->_delta : 0;
+}
+
+void
+SoftTimer::advance(timeout_t ticks)
+{
+    while ((ticks > 0) && (_running != nullptr)) {
+        if (_running->_delta > ticks) {
+            _running->_delta -= ticks;
+            return;
+        }
+
+        ticks -= _running->_delta;
+        _running->_delta = 0;
+
+        while ((_running != nullptr) && (_running->_delta == 0)) {
+            auto t = _running;
+            _running = t->_next;
+            t->expire();
+        }
+    }
+}
+
+void
+SoftTimer::run()
+{
+    for (;;) {
+        SoftTimer *t;
+
+        {
+            TCritSect cs;
+
+            while ((t = _queue_head) == nullptr) {
+                _queue_event.wait();
+            }
+
+            _queue_head = t->_next_queued;
+
+            if (_queue_head == nullptr) {
+                _queue_tail = nullptr;
+            }
+
+            t->_queued = false;
+            _queue_depth--;
+        }
+
+        t->_callback(t->_arg);
+    }
+}
+
+/****************************************************************************
+ * Kernel hooks
+ */
+
+void
+OS::system_timer_user_hook()
+{
+    SoftTimer::tick();
+}
+
+#if scmRTOS_TICKLESS_IDLE_ENABLE == 1
+timeout_t
+OS::system_timer_user_nearest()
+{
+    return SoftTimer::nearest();
+}
+
+void
+OS::system_timer_user_advance(timeout_t ticks)
+{
+    SoftTimer::advance(ticks);
+}
+#endif
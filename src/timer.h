@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file timer.h
+ *
+ * Software timers.
+ *
+ * One-shot and periodic timers driven by the system tick. Running timers
+ * are kept on a list sorted by expiry, each holding the ticks after the
+ * timer before it, so a tick only ever looks at the head of the list.
+ *
+ * Callbacks either run in the tick interrupt, where they must be short
+ * and may only use the _isr kernel calls, or are queued for the timer
+ * process, which runs them one at a time at its own priority.
+ */
+
+#pragma once
+
+#include <scmRTOS.h>
+
+class SoftTimer
+{
+public:
+    typedef void                (*Callback)(void *arg);
+
+    enum Context : uint8_t {
+        CTX_PROCESS,            ///< callback runs in the timer process
+        CTX_TICK                ///< callback runs in the system tick interrupt
+    };
+
+    SoftTimer(Callback callback, void *arg = nullptr, Context context = CTX_PROCESS) :
+        _callback(callback),
+        _arg(arg),
+        _context(context)
+    {
+    }
+
+    /**
+     * Start or restart the timer.
+     *
+     * Safe to call from interrupt handlers and timer callbacks.
+     *
+     * @param ticks             Ticks until the first expiry, at least 1.
+     * @param period            Ticks between later expiries, 0 for a
+     *                          one-shot timer.
+     */
+    void                        start(timeout_t ticks, timeout_t period = 0);
+
+    /**
+     * Stop the timer.
+     *
+     * A callback that is queued for the timer process is cancelled.
+     */
+    void                        stop();
+
+    /**
+     * Expire the timer now.
+     *
+     * The callback runs as it would on expiry; a periodic timer carries
+     * on from now. Safe to call from interrupt handlers and timer
+     * callbacks.
+     */
+    void                        fire();
+
+    /**
+     * @return                  True if the timer will expire again.
+     */
+    bool                        running() const;
+
+    /**
+     * Run queued callbacks; the body of the timer process.
+     */
+    static void                 run() __attribute__((noreturn));
+
+    /** process-context expiries dropped because the callback was still queued */
+    static unsigned             overruns;
+
+    /** most callbacks waiting for the timer process at once */
+    static unsigned             queue_high_water;
+
+    /**
+     * Advance the running timers by one tick.
+     *
+     * Called from the system timer hook.
+     */
+    static void                 tick();
+
+    /**
+     * @return                  Ticks until the next timer expires, 0 if
+     *                          none are running.
+     */
+    static timeout_t            nearest();
+
+    /**
+     * Account for ticks skipped by tickless idle.
+     *
+     * Called with interrupts disabled; never more ticks than nearest().
+     */
+    static void                 advance(timeout_t ticks);
+
+private:
+    const Callback              _callback;
+    void                        *const _arg;
+    const Context               _context;
+    bool                        _active = false;        ///< on the running list
+    bool                        _queued = false;        ///< on the callback queue
+    timeout_t                   _delta = 0;             ///< ticks after the previous running timer
+    timeout_t                   _period = 0;
+    SoftTimer                   *_next = nullptr;       ///< running list link
+    SoftTimer                   *_next_queued = nullptr; ///< callback queue link
+
+    void                        insert(timeout_t ticks);
+    void                        remove();
+    void                        expire();
+
+    static SoftTimer            *_running;
+    static SoftTimer            *_queue_head;
+    static SoftTimer            *_queue_tail;
+    static unsigned             _queue_depth;
+    static OS::TEventFlag       _queue_event;
+};
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file trace.cpp
+ *
+ * Event trace recorder.
+ *
+ * The dump is printed as text so that it can be picked out of the
+ * console log:
+ *
+ *   trace begin <cycles per us> <records>
+ *   <timestamp><event><id><data>       (hex, one record per line)
+ *   trace end
+ */
+
+#include "board.h"
+#include "trace.h"
+
+namespace Trace
+{
+
+namespace
+{
+volatile bool dump_requested;
+
+#if TRACE_RECORDS > 0
+static_assert((TRACE_RECORDS & (TRACE_RECORDS - 1)) == 0, "TRACE_RECORDS must be a power of 2");
+
+Record ring[TRACE_RECORDS];
+unsigned next;                  // total records written, wraps
+volatile bool frozen;
+
+bool dumping;
+unsigned dump_first;            // oldest record in the dump
+unsigned dump_count;
+unsigned dump_line;             // next line; 0 is the header
+#endif
+} // namespace
+
+#if TRACE_RECORDS > 0
+void
+record(Event event, uint8_t id, uint16_t data)
+{
+    TCritSect cs;
+
+    if (frozen)
+        return;
+
+    auto &r = ring[next++ & (TRACE_RECORDS - 1)];
+    r.timestamp = gBoard->cycle_count();
+    r.event = event;
+    r.id = id;
+    r.data = data;
+}
+#endif
+
+void
+request_dump()
+{
+    dump_requested = true;
+}
+
+bool
+dump_if_requested()
+{
+#if TRACE_RECORDS > 0
+    // a record line is at most this long on the wire, framed or as text
+    const unsigned line_space = 32;
+
+    if (dump_requested && !dumping) {
+        dump_requested = false;
+        dumping = true;
+        frozen = true;
+
+        // oldest record first
+        dump_count = (next < TRACE_RECORDS) ? next : TRACE_RECORDS;
+        dump_first = next - dump_count;
+        dump_line = 0;
+    }
+
+    if (!dumping)
+        return false;
+
+    // the dump is far bigger than the console transmit ring, so print
+    // what fits now and come back for the rest rather than wait for room
+    while (gBoard->com_tx_space() >= line_space) {
+        if (dump_line == 0) {
+            debug("trace begin %u %u", gBoard->cycles_per_us(), dump_count);
+
+        } else if (dump_line <= dump_count) {
+            auto &r = ring[(dump_first + dump_line - 1) & (TRACE_RECORDS - 1)];
+            debug("%08lx%02x%02x%04x", (unsigned long)r.timestamp, r.event, r.id, r.data);
+
+        } else {
+            debug("trace end");
+
+            next = 0;
+            frozen = false;
+            dumping = false;
+            return false;
+        }
+
+        dump_line++;
+    }
+
+    return true;
+#else
+    if (dump_requested) {
+        dump_requested = false;
+        debug("trace not enabled");
+    }
+
+    return false;
+#endif
+}
+
+} // namespace Trace
+
+#if scmRTOS_ISRW_USER_HOOK_ENABLE == 1
+void
+OS::isrw_enter_user_hook(uint_fast8_t exception)
+{
+    Trace::record(Trace::EV_ISR_ENTER, exception);
+}
+
+void
+OS::isrw_exit_user_hook(uint_fast8_t exception)
+{
+    Trace::record(Trace::EV_ISR_EXIT, exception);
+}
+#endif
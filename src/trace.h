@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2012-2015, Mike Smith, <msmith@purgatory.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * o Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file trace.h
+ *
+ * Event trace recorder.
+ *
+ * Events are stored as packed 8-byte records in a RAM ring, timestamped
+ * with the board cycle counter, and dumped over the console on request.
+ * host/trace2json converts a dump into Chrome / Perfetto trace JSON.
+ *
+ * Build with -DTRACE_RECORDS=0 to compile the recorder out.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef TRACE_RECORDS
+# define TRACE_RECORDS  256     // must be a power of 2
+#endif
+
+namespace Trace
+{
+
+enum Event : uint8_t {
+    EV_SWITCH,                  ///< context switch, id = outgoing process priority
+    EV_ISR_ENTER,               ///< id = exception number
+    EV_ISR_EXIT,                ///< id = exception number
+    EV_PACKET,                  ///< packet decoded, id = 1 if bad, data = packet count
+    EV_FRAME,                   ///< frame rendered, id = pages sent, data = render time (us)
+};
+
+struct Record {
+    uint32_t                    timestamp;      ///< cycle counter
+    Event                       event;
+    uint8_t                     id;
+    uint16_t                    data;
+} __attribute__((packed));
+
+static_assert(sizeof(Record) == 8, "trace records must be 8 bytes");
+
+/**
+ * Add an event to the trace.
+ *
+ * Safe to call from interrupt handlers. Events are discarded while the
+ * trace is being dumped.
+ */
+#if TRACE_RECORDS > 0
+extern void record(Event event, uint8_t id = 0, uint16_t data = 0);
+#else
+static inline void record(Event event __attribute__((unused)),
+                          uint8_t id __attribute__((unused)) = 0,
+                          uint16_t data __attribute__((unused)) = 0) {}
+#endif
+
+/**
+ * Ask for the trace to be dumped.
+ */
+extern void request_dump();
+
+/**
+ * Dump the trace to the console if a dump has been requested.
+ *
+ * Never waits for the console; each call prints as many lines as the
+ * transmit ring has room for. The ring is frozen while it is printed
+ * and cleared afterwards.
+ *
+ * @return                      True until the dump is finished; call
+ *                              again once the console has drained.
+ */
+extern bool dump_if_requested();
+
+} // namespace Trace
@@ -35,6 +35,14 @@
 
 #include "EBLmon.h"
 #include "board.h"
+#include "boot.h"
+#include "frame.h"
+#include "layout.h"
+#include "perf.h"
+#include "retained.h"
+#include "settings.h"
+#include "stackmon.h"
+#include "trace.h"
 
 #include <u8g.h>
 #include <m2.h>
@@ -48,32 +56,280 @@ namespace UI
 // graphics driver
 u8g_t u8g;
 
-// root of the UI tree
-M2_EXTERN_ALIGN(ui_gauges);
+// decoded frames, only the latest is of interest
+EBL::FrameQueue<1> frames;
+
+// things that wake the GUI process
+enum : OS::TEventGroup::TBits {
+    EV_FRAME        = 1U << 0,
+};
+OS::TEventGroup events;
+
+// the keys have no interrupt and must be polled
+const timeout_t key_poll_period = 10;
+
+// menus
+M2_EXTERN_ALIGN(_top);
+M2_EXTERN_ALIGN(_stats);
 
 // fonts
 const void *const ui_fonts[] = {
     u8g_font_6x13B,             // f0 - medium text
     u8g_font_profont22,         // f1 - large display fields
+    u8g_font_5x8,               // f2 - small text
     NULL
 };
 
-char road_speed[8] = {'-', '\0'};
-char engine_speed[8] = {'-', '\0'};
-char water_temperature[8] = {'-', '\0'};
-char oil_pressure[8] = {'-', '\0'};
-char battery_voltage[8] = {'-', '\0'};
-char air_fuel_ratio[8] = {'-', '\0'};
-char ebl_status[22] = {'N', 'O', 'T', ' ', 'C', 'O', 'N', 'N', 'E', 'C', 'T', 'E', 'D', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', '\0'};
+// Status display - four-quadrant display plus status bar
+//
+constexpr Cell gauges_cells[] = {
+    cell(0,  0,  64,  24, CH_WATER_TEMPERATURE, u8g_font_profont22),
+    cell(64, 0,  64,  24, CH_OIL_PRESSURE,      u8g_font_profont22),
+    cell(0,  26, 64,  24, CH_BATTERY_VOLTAGE,   u8g_font_profont22),
+    cell(64, 26, 64,  24, CH_AIR_FUEL_RATIO,    u8g_font_profont22),
+    cell(0,  51, 128, 13, CH_STATUS,            u8g_font_6x13B, ALIGN_LEFT),
+};
+const Layout gauges_layout = LAYOUT(gauges_cells);
+
+// Mini-dashboard - speed on top, RPM below
+//
+constexpr Cell dash_cells[] = {
+    cell(0,  0,  128, 24, CH_ROAD_SPEED,        u8g_font_profont22),
+    cell(0,  26, 128, 24, CH_ENGINE_SPEED,      u8g_font_profont22),
+    cell(0,  51, 128, 13, CH_STATUS,            u8g_font_6x13B, ALIGN_LEFT),
+};
+const Layout dash_layout = LAYOUT(dash_cells);
+
+// gauge screens, by the number kept across a reset
+const Layout *const screens[] = {
+    &gauges_layout,
+    &dash_layout,
+};
+
+// active gauge layout, NULL while the menus are up
+const Layout *layout;
+uint8_t dirty_pages;
+
+char stats_packets[26];
+char stats_fps[26];
+char stats_render[26];
+char stats_late[26];
+char stats_cpu[26];
+
+/*
+ * Display refresh governor.
+ *
+ * Each screen has a nominal refresh period. Live data screens render when
+ * a new packet arrives but no more often than that; other screens render
+ * on a key press or when the period expires. If a frame takes more than
+ * render_budget percent of the period to draw, the period is stretched to
+ * bring rendering back within budget, then relaxed back towards nominal
+ * once there is headroom again.
+ */
+struct RefreshPolicy {
+    const void  *screen;        // layout or m2 root this applies to, NULL matches anything
+    unsigned    period;         // nominal refresh period (ms)
+    bool        on_packet;      // render when a new packet arrives
+};
+
+const RefreshPolicy refresh_policies[] = {
+    { &gauges_layout,   40,     true  },
+    { &dash_layout,     40,     true  },
+    { &_stats,          500,    false },
+    { NULL,             250,    false },    // menus
+};
+
+const unsigned render_budget = 50;      // percent of the refresh period
+const unsigned refresh_max = 1000;      // longest governed period (ms)
+
+const RefreshPolicy *refresh_policy;
+unsigned    refresh_period;             // current governed period (ms)
+tick_count_t last_frame;                // start of the previous frame
+tick_count_t due_since;                 // when the pending frame was requested
+bool        redraw_needed;
+
+// render time histogram, 512us buckets, last bucket catches overruns
+const unsigned render_hist_shift = 9;
+const unsigned render_hist_size = 32;
+uint16_t    render_hist[render_hist_size];
+unsigned    render_hist_count;
+
+unsigned    frame_count;                // frames in the current FPS window
+tick_count_t fps_window;                // start of the current FPS window
+unsigned    fps;                        // frames per second * 10
+unsigned    missed_deadlines;
+
+const unsigned retained_period = 250;   // ms between frames saved for a warm boot
+tick_count_t retained_saved;
+
+static const RefreshPolicy *
+find_policy(const void *screen)
+{
+    auto policy = &refresh_policies[0];
+
+    while ((policy->screen != NULL) && (policy->screen != screen)) {
+        policy++;
+    }
+
+    return policy;
+}
+
+static void
+render_time_record(unsigned us)
+{
+    auto bucket = us >> render_hist_shift;
+
+    if (bucket >= render_hist_size) {
+        bucket = render_hist_size - 1;
+    }
+
+    // age the histogram rather than letting it saturate
+    if (render_hist[bucket] == UINT16_MAX) {
+        render_hist_count = 0;
+
+        for (unsigned i = 0; i < render_hist_size; i++) {
+            render_hist[i] /= 2;
+            render_hist_count += render_hist[i];
+        }
+    }
+
+    render_hist[bucket]++;
+    render_hist_count++;
+}
+
+// render time percentile in units of 0.1ms, rounded up to the bucket boundary
+static unsigned
+render_time_percentile(unsigned percent)
+{
+    unsigned target = (render_hist_count * percent + 99) / 100;
+    unsigned seen = 0;
+
+    for (unsigned i = 0; i < render_hist_size; i++) {
+        seen += render_hist[i];
+
+        if ((seen > 0) && (seen >= target)) {
+            return (((i + 1) << render_hist_shift) + 99) / 100;
+        }
+    }
+
+    return 0;
+}
+
+static void
+governor_update(unsigned render_us)
+{
+    auto budget_us = refresh_period * 10 * render_budget;
+
+    if (render_us > budget_us) {
+        // stretch the period far enough to bring rendering back within budget
+        refresh_period = render_us / (10 * render_budget) + 1;
+
+        if (refresh_period > refresh_max) {
+            refresh_period = refresh_max;
+        }
+
+    } else if ((render_us < (budget_us / 2)) && (refresh_period > refresh_policy->period)) {
+        // plenty of headroom, relax towards the nominal rate
+        refresh_period -= (refresh_period - refresh_policy->period + 7) / 8;
+    }
+}
+
+static void
+update_stats()
+{
+    auto p50 = render_time_percentile(50);
+    auto p90 = render_time_percentile(90);
+    auto p99 = render_time_percentile(99);
+
+    snprintf(stats_packets, sizeof(stats_packets), "pkt %u bad %u", EBL::good_packets, EBL::bad_packets);
+    snprintf(stats_fps, sizeof(stats_fps), "fps %u.%u / %ums", fps / 10, fps % 10, refresh_period);
+    snprintf(stats_render, sizeof(stats_render), "rt %u.%u %u.%u %u.%ums",
+             p50 / 10, p50 % 10, p90 / 10, p90 % 10, p99 / 10, p99 % 10);
+    snprintf(stats_late, sizeof(stats_late), "late %u", missed_deadlines);
+    snprintf(stats_cpu, sizeof(stats_cpu), "cpu d%u g%u t%u i%u%%",
+             Perf::cpu_load(OS::pr0) / 100,
+             Perf::cpu_load(OS::pr1) / 100,
+             Perf::cpu_load(OS::pr2) / 100,
+             Perf::cpu_load(OS::prIDLE) / 100);
+}
+
+static void
+draw(tick_count_t now, tick_count_t due)
+{
+    auto start = gBoard->cycle_count();
+    uint8_t pages = (layout != NULL) ? dirty_pages : 0xff;
+
+    /* picture loop */
+    if (layout != NULL) {
+        // only the dirty pages are sent to the display
+        gBoard->display_page_mask = dirty_pages;
+        u8g_FirstPage(&u8g);
+
+        do {
+            layout_draw(&u8g, layout, dirty_pages);
+            m2_CheckKey();
+        } while (u8g_NextPage(&u8g));
+
+        gBoard->display_page_mask = 0xff;
+        dirty_pages = 0;
+
+    } else {
+        u8g_FirstPage(&u8g);
+
+        do {
+            m2_Draw();
+            m2_CheckKey();
+        } while (u8g_NextPage(&u8g));
+    }
+
+    auto render_us = (gBoard->cycle_count() - start) / gBoard->cycles_per_us();
+    Trace::record(Trace::EV_FRAME, pages, (render_us > 0xffff) ? 0xffff : render_us);
+    Boot::mark(Boot::BOOT_GAUGES);
+
+    // late if it started a full period after it was due, or couldn't finish within one
+    if (((now - due) >= refresh_period) || (render_us >= (refresh_period * 1000))) {
+        missed_deadlines++;
+    }
+
+    render_time_record(render_us);
+    governor_update(render_us);
+
+    last_frame = now;
+    redraw_needed = false;
+    frame_count++;
+}
+
+static void
+show_layout(const Layout *l)
+{
+    layout = l;
+    dirty_pages = 0xff;
+    m2_SetRoot(&m2_null_element);
+
+    for (unsigned i = 0; i < (sizeof(screens) / sizeof(screens[0])); i++) {
+        if (screens[i] == l) {
+            Retained::save_screen(i);
+        }
+    }
+}
+
+static void
+show_menu()
+{
+    layout = NULL;
+    m2_SetRootExtended(&_top, 2, 0);
+}
 
 void
 init()
 {
-    // graphics driver init
+    // graphics driver init; after a warm reset the display is still set up
+    gBoard->display_warm_start = Retained::warm;
     u8g_Init(&u8g, gBoard->u8g_dev());
+    Boot::mark(Boot::BOOT_DISPLAY);
 
     // m2tk init
-    m2_Init(&ui_gauges,         // UI root
+    m2_Init(&m2_null_element,   // UI root, gauges are drawn directly
             m2_board_es,        // event source
             m2_eh_4bd,          // event handler
             m2_gh_u8g_bfs);     // UI style
@@ -83,57 +339,181 @@ init()
         m2_SetFont(i, ui_fonts[i]);
     }
 
+    auto screen = Retained::screen();
+
+    show_layout(screens[(screen < (sizeof(screens) / sizeof(screens[0]))) ? screen : 0]);
+
+    // put the last values back up rather than wait for a packet
+    if (auto last = EBL::frame_alloc()) {
+        if (Retained::restore_frame(*last)) {
+            channels_update(*last);
+        }
+
+        EBL::frame_release(last);
+    }
+
+    // draw the gauges now rather than on the first tick, so there is
+    // something on the screen before the first packet arrives
+    auto now = OS::get_tick_count();
+
+    refresh_policy = find_policy(layout);
+    refresh_period = refresh_policy->period;
+    draw(now, now);
+
+    frames.notify(events, EV_FRAME);
+    EBL::subscribe(frames);
+}
+
+void
+wait()
+{
+    timeout_t timeout = key_poll_period;
+
+    // don't sleep through a pending redraw
+    if (redraw_needed) {
+        auto since = OS::get_tick_count() - last_frame;
+        auto left = (since < refresh_period) ? (refresh_period - since) : 1;
+
+        if (left < timeout) {
+            timeout = left;
+        }
+    }
+
+    events.wait_any(EV_FRAME, timeout);
 }
 
 void
 tick()
 {
+    auto now = OS::get_tick_count();
+
     m2_CheckKey();
-    m2_HandleKey();
 
-    /* picture loop */
-    u8g_FirstPage(&u8g);
+    if (layout != NULL) {
+        // select steps gauges -> dash -> menu
+        if (m2_GetKey() == M2_KEY_SELECT) {
+            if (layout == &gauges_layout) {
+                show_layout(&dash_layout);
+
+            } else {
+                show_menu();
+            }
+        }
+
+    } else if (m2_HandleKey()) {
+        redraw_needed = true;
+        due_since = now;
+    }
+
+    // switching screens resets the governor to the new screen's nominal rate
+    auto policy = find_policy((layout != NULL) ? (const void *)layout : m2_GetRoot());
+
+    if (policy != refresh_policy) {
+        refresh_policy = policy;
+        refresh_period = policy->period;
+        redraw_needed = true;
+        due_since = now;
+    }
 
-    do {
-        m2_Draw();
-        m2_CheckKey();
-    } while (u8g_NextPage(&u8g));
+    unsigned changed = 0;
 
-    if (EBL::was_updated()) {
+    if (auto frame = frames.try_get()) {
+        changed = channels_update(*frame);
 
-        sprintf(road_speed, "%umph", EBL::ground_speed());
-        sprintf(engine_speed, "%urpm", EBL::engine_speed());
-        sprintf(water_temperature, "%u\xb0", EBL::water_temperature());
-        sprintf(oil_pressure, "%u#", EBL::oil_pressure());
-        sprintf(battery_voltage, "%u.%uv", EBL::voltage() / 10, EBL::voltage() % 10);
-        sprintf(air_fuel_ratio, "%u.%u", EBL::afr() / 10, EBL::afr() % 10);
+        if ((now - retained_saved) >= retained_period) {
+            Retained::save_frame(*frame);
+            retained_saved = now;
+        }
 
-        if (EBL::ses_set()) {
-            sprintf(ebl_status, "CHECK ENGINE [%s]", EBL::dtc_string(0) ? : "??????");
+        Boot::mark(Boot::BOOT_FIRST_FRAME);
+    }
 
-        } else if (EBL::engine_running()) {
-            sprintf(ebl_status, "OK                   ");
+    // a stack alarm takes over the status line, except from CHECK ENGINE
+    if (auto proc = StackMon::alarm()) {
+        char text[22];
 
-        } else {
-            sprintf(ebl_status, "NOT RUNNING          ");
+        snprintf(text, sizeof(text), "STACK LOW %s", proc);
+        changed |= channel_alert(CH_STATUS, text);
+    }
+
+    if (changed) {
+        if (layout != NULL) {
+            dirty_pages |= layout_dirty_pages(layout, changed);
         }
 
+        if (refresh_policy->on_packet && !redraw_needed && (dirty_pages != 0)) {
+            redraw_needed = true;
+            due_since = now;
+        }
+    }
+
+    // screens that don't follow the packet stream refresh periodically
+    if (!refresh_policy->on_packet && !redraw_needed && ((now - last_frame) >= refresh_period)) {
+        redraw_needed = true;
+        due_since = last_frame + refresh_period;
+    }
+
+    if ((now - fps_window) >= 1000) {
+        fps = (frame_count * 10000) / (now - fps_window);
+        frame_count = 0;
+        fps_window = now;
+    }
+
+    if (redraw_needed && ((now - last_frame) >= refresh_period)) {
+        if (refresh_policy->screen == &_stats) {
+            update_stats();
+        }
+
+        // a frame isn't due until the previous frame's period has run out
+        auto due = due_since;
+
+        if ((due - last_frame) < refresh_period) {
+            due = last_frame + refresh_period;
+        }
+
+        draw(now, due);
     }
 }
 
 
-M2_EXTERN_ALIGN(_top);
 M2_EXTERN_ALIGN(_settings);
-M2_EXTERN_ALIGN(_stats);
+M2_EXTERN_ALIGN(_settings_afr);
+
+void _show_gauges(m2_el_fnarg_p fnarg) { show_layout(&gauges_layout); }
+void _dump_trace(m2_el_fnarg_p fnarg) { Trace::request_dump(); }
+void _dump_stacks(m2_el_fnarg_p fnarg) { StackMon::request_dump(); }
+
+// settings are edited in a copy, and saved all at once
+uint32_t _settings_values[Settings::NUM_SETTINGS];
 
-const char *ui_status_text = &ebl_status[0];
+void
+_edit_settings(m2_el_fnarg_p fnarg)
+{
+    for (unsigned i = 0; i < Settings::NUM_SETTINGS; i++) {
+        _settings_values[i] = Settings::get((Settings::Key)i);
+    }
+
+    m2_SetRoot(&_settings);
+}
+
+void
+_save_settings(m2_el_fnarg_p fnarg)
+{
+    // the number fields edit 32 bits, settings are stored as 16
+    for (unsigned i = 0; i < Settings::NUM_SETTINGS; i++) {
+        uint32_t value = _settings_values[i];
+        Settings::set((Settings::Key)i, (value > UINT16_MAX) ? UINT16_MAX : value);
+    }
+
+    m2_SetRoot(&_top);
+}
 
 // Top-level menu
 //
 M2_LABEL(_top_title, "f1", "Menu");
-M2_ROOT(_top_settings, "f0", "Settings", &_settings);
+M2_BUTTON(_top_settings, "f0", "Settings", &_edit_settings);
 M2_ROOT(_top_stats, "f0", "Stats", &_stats);
-M2_ROOT(_top_done, "f0", "DONE", &ui_gauges);
+M2_BUTTON(_top_done, "f0", "DONE", &_show_gauges);
 M2_LIST(_top_list) = {
     &_top_title,
     &_top_settings,
@@ -143,84 +523,90 @@ M2_LIST(_top_list) = {
 M2_VLIST(_top_vlist, NULL, _top_list);
 M2_ALIGN(_top, "-0|2W64H63", &_top_vlist);
 
-// Settings menu
+// Settings menus
 //
-M2_LABEL(_settings_title, "f1", "Settings");
-M2_ROOT(_settings_done, "f0", "DONE", &_top);
-M2_LIST(_settings_list) = {
-    &_settings_title,
-    &_settings_done
+// A 64px panel holds three small-font rows and the buttons, so the
+// settings are split across two pages that edit the same copy.
+M2_LABEL(_settings_oil_zero_label, "f2", "Oil 0psi ADCx10");
+M2_U32NUM(_settings_oil_zero, "f2c5", &_settings_values[Settings::SET_OIL_ZERO]);
+M2_LABEL(_settings_oil_full_label, "f2", "Oil full ADCx10");
+M2_U32NUM(_settings_oil_full, "f2c5", &_settings_values[Settings::SET_OIL_FULL]);
+M2_LABEL(_settings_oil_range_label, "f2", "Oil full psi");
+M2_U32NUM(_settings_oil_range, "f2c3", &_settings_values[Settings::SET_OIL_RANGE]);
+M2_LIST(_settings_oil_grid_list) = {
+    &_settings_oil_zero_label,  &_settings_oil_zero,
+    &_settings_oil_full_label,  &_settings_oil_full,
+    &_settings_oil_range_label, &_settings_oil_range
+};
+M2_GRIDLIST(_settings_oil_grid, "c2", _settings_oil_grid_list);
+M2_ROOT(_settings_next, "f0", "NEXT", &_settings_afr);
+M2_ROOT(_settings_oil_done, "f0", "DONE", &_top);
+M2_LIST(_settings_oil_buttons_list) = {
+    &_settings_next,
+    &_settings_oil_done
+};
+M2_HLIST(_settings_oil_buttons, NULL, _settings_oil_buttons_list);
+M2_LIST(_settings_oil_list) = {
+    &_settings_oil_grid,
+    &_settings_oil_buttons
 };
-M2_VLIST(_settings_vlist, NULL, _settings_list);
-M2_ALIGN(_settings, "-0|2W64H63", &_settings_vlist);
+M2_VLIST(_settings_oil_vlist, NULL, _settings_oil_list);
+M2_ALIGN(_settings, "-0|2W64H63", &_settings_oil_vlist);
+
+M2_LABEL(_settings_afr_low_label, "f2", "AFR@0V x10");
+M2_U32NUM(_settings_afr_low, "f2c3", &_settings_values[Settings::SET_AFR_LOW]);
+M2_LABEL(_settings_afr_high_label, "f2", "AFR@5V x10");
+M2_U32NUM(_settings_afr_high, "f2c3", &_settings_values[Settings::SET_AFR_HIGH]);
+M2_LIST(_settings_afr_grid_list) = {
+    &_settings_afr_low_label,   &_settings_afr_low,
+    &_settings_afr_high_label,  &_settings_afr_high
+};
+M2_GRIDLIST(_settings_afr_grid, "c2", _settings_afr_grid_list);
+M2_BUTTON(_settings_save, "f0", "SAVE", &_save_settings);
+M2_ROOT(_settings_afr_done, "f0", "DONE", &_top);
+M2_LIST(_settings_afr_buttons_list) = {
+    &_settings_save,
+    &_settings_afr_done
+};
+M2_HLIST(_settings_afr_buttons, NULL, _settings_afr_buttons_list);
+M2_LIST(_settings_afr_list) = {
+    &_settings_afr_grid,
+    &_settings_afr_buttons
+};
+M2_VLIST(_settings_afr_vlist, NULL, _settings_afr_list);
+M2_ALIGN(_settings_afr, "-0|2W64H63", &_settings_afr_vlist);
 
 // Stats menu
 //
-M2_U32NUM(_stats_pkts, "r1f0", (uint32_t *)&EBL::good_packets);
-M2_U32NUM(_stats_badpkts, "r1f0", (uint32_t *)&EBL::bad_packets);
+const char *_stats_packets_text = &stats_packets[0];
+const char *_stats_fps_text = &stats_fps[0];
+const char *_stats_render_text = &stats_render[0];
+const char *_stats_late_text = &stats_late[0];
+const char *_stats_cpu_text = &stats_cpu[0];
+
+M2_LABELPTR(_stats_packets, "f2", &_stats_packets_text);
+M2_LABELPTR(_stats_fps, "f2", &_stats_fps_text);
+M2_LABELPTR(_stats_render, "f2", &_stats_render_text);
+M2_LABELPTR(_stats_late, "f2", &_stats_late_text);
+M2_LABELPTR(_stats_cpu, "f2", &_stats_cpu_text);
+M2_BUTTON(_stats_trace, "f0", "TRACE", &_dump_trace);
+M2_BUTTON(_stats_stacks, "f0", "STACK", &_dump_stacks);
 M2_ROOT(_stats_done, "f0", "DONE", &_top);
-M2_LIST(_stats_list) = {
-    &_stats_pkts,
-    &_stats_badpkts,
+M2_LIST(_stats_buttons_list) = {
+    &_stats_trace,
+    &_stats_stacks,
     &_stats_done
 };
+M2_HLIST(_stats_buttons, NULL, _stats_buttons_list);
+M2_LIST(_stats_list) = {
+    &_stats_packets,
+    &_stats_fps,
+    &_stats_render,
+    &_stats_late,
+    &_stats_cpu,
+    &_stats_buttons
+};
 M2_VLIST(_stats_vlist, NULL, _stats_list);
 M2_ALIGN(_stats, "-0|2W64H63", &_stats_vlist);
 
-// Mini-dashboard - speed on top, RPM below
-//
-const char *ui_2cell_1_text = &road_speed[0];
-const char *ui_2cell_2_text = &engine_speed[0];
-
-M2_LABELPTR(_dash_cell_1_, "f1", &ui_2cell_1_text);
-M2_ALIGN(_dash_cell_1, "x0y40w128h24", &_dash_cell_1_);
-
-M2_LABELPTR(_dash_cell_2_, "f1", &ui_2cell_2_text);
-M2_ALIGN(_dash_cell_2, "x0y14w128h24", &_dash_cell_2_);
-
-void _leave_dash(m2_el_fnarg_p fnarg) { m2_SetRootExtended(&_top, 2, 0); }
-M2_BUTTONPTR(_dash_status,     "x0y0f0", &ui_status_text, &_leave_dash);
-
-M2_LIST(_dash_list) = {
-    &_dash_cell_1,
-    &_dash_cell_2,
-    &_dash_status
-};
-
-M2_XYLIST(_dash_vlist, NULL, _dash_list);
-M2_ALIGN(_dash, "-0|2W64H63", &_dash_vlist);
-
-// Status display - Four-quadrant display plus status bar
-//
-const char *_gauge_1_text = &water_temperature[0];
-const char *_gauge_2_text = &oil_pressure[0];
-const char *_gauge_3_text = &battery_voltage[0];
-const char *_gauge_4_text = &air_fuel_ratio[0];
-
-M2_LABELPTR(_gauges_cell_1_, "f1", &_gauge_1_text);
-M2_ALIGN(_gauges_cell_1, "x0y40w64h24", &_gauges_cell_1_);
-
-M2_LABELPTR(_gauges_cell_2_, "f1", &_gauge_2_text);
-M2_ALIGN(_gauges_cell_2, "x64y40w64h24", &_gauges_cell_2_);
-
-M2_LABELPTR(_gauges_cell_3_, "f1", &_gauge_3_text);
-M2_ALIGN(_gauges_cell_3, "x0y14w64h24", &_gauges_cell_3_);
-
-M2_LABELPTR(_gauges_cell_4_, "f1", &_gauge_4_text);
-M2_ALIGN(_gauges_cell_4, "x64y14w64h24", &_gauges_cell_4_);
-
-void _leave_gauges(m2_el_fnarg_p fnarg) { m2_SetRootExtended(&_dash, 0, 0); }
-M2_BUTTONPTR(_gauges_status,     "x0y0f0", &ui_status_text, &_leave_gauges);
-
-M2_LIST(_gauges_list) = {
-    &_gauges_cell_1,
-    &_gauges_cell_2,
-    &_gauges_cell_3,
-    &_gauges_cell_4,
-    &_gauges_status
-};
-
-M2_XYLIST(_gauges_vlist, NULL, _gauges_list);
-M2_ALIGN(ui_gauges, "-0|2W64H63", &_gauges_vlist);
-
 } // namespace UI